@@ -0,0 +1,219 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityexport.h"
+
+#include <QFile>
+
+static const QByteArray EXPORT_MAGIC = QByteArrayLiteral("# plasma-timekeeper export 2");
+static const QByteArray USER_PREFIX = QByteArrayLiteral("# user ");
+static const QByteArray HOST_PREFIX = QByteArrayLiteral("# host ");
+
+static QByteArray singleLine(const QString &value)
+{
+    QString result = value;
+    result.replace(QLatin1Char('\n'), QLatin1Char(' '));
+    return result.toUtf8();
+}
+
+/*                     ActivityExportWriter::Private                       *
+ * ----------------------------------------------------------------------- */
+class ActivityExportWriter::Private
+{
+public:
+    QFile file;
+};
+
+/*                        ActivityExportWriter                             *
+ * ----------------------------------------------------------------------- */
+
+ActivityExportWriter::ActivityExportWriter()
+    : d(new Private())
+{
+}
+
+ActivityExportWriter::~ActivityExportWriter()
+{
+    close();
+    delete d;
+}
+
+bool ActivityExportWriter::open(const QString &path, const QString &user, const QString &host)
+{
+    close();
+
+    if (path.isEmpty()) {
+        if (!d->file.open(stdout, QIODevice::WriteOnly)) {
+            return false;
+        }
+    } else {
+        d->file.setFileName(path);
+        if (!d->file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+    }
+
+    d->file.write(EXPORT_MAGIC + '\n');
+    d->file.write(USER_PREFIX + singleLine(user) + '\n');
+    return d->file.write(HOST_PREFIX + singleLine(host) + '\n') > 0;
+}
+
+void ActivityExportWriter::close()
+{
+    d->file.close();
+}
+
+bool ActivityExportWriter::write(const ActivityExportRecord &record)
+{
+    QByteArray line = QByteArray::number(record.start);
+    line += '\t';
+    line += QByteArray::number(record.seconds);
+    line += '\t';
+    line += singleLine(record.user).replace('\t', ' ');
+    line += '\t';
+    line += singleLine(record.activity);
+    line += '\n';
+
+    return d->file.write(line) == line.size();
+}
+
+/*                     ActivityExportReader::Private                       *
+ * ----------------------------------------------------------------------- */
+class ActivityExportReader::Private
+{
+public:
+    QFile file;
+    QString user;
+    QString host;
+
+    // First line after the header, read while looking for it
+    QByteArray pendingLine;
+};
+
+/*                        ActivityExportReader                             *
+ * ----------------------------------------------------------------------- */
+
+ActivityExportReader::ActivityExportReader()
+    : d(new Private())
+{
+}
+
+ActivityExportReader::~ActivityExportReader()
+{
+    close();
+    delete d;
+}
+
+bool ActivityExportReader::open(const QString &path)
+{
+    close();
+
+    d->file.setFileName(path);
+    if (!d->file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray magic = d->file.readLine().trimmed();
+    if (magic != EXPORT_MAGIC) {
+        close();
+        return false;
+    }
+
+    while (!d->file.atEnd()) {
+        const QByteArray line = d->file.readLine();
+        if (line.startsWith(USER_PREFIX)) {
+            d->user = QString::fromUtf8(line.mid(USER_PREFIX.size()).trimmed());
+        } else if (line.startsWith(HOST_PREFIX)) {
+            d->host = QString::fromUtf8(line.mid(HOST_PREFIX.size()).trimmed());
+        } else if (!line.startsWith('#')) {
+            d->pendingLine = line;
+            break;
+        }
+    }
+
+    return true;
+}
+
+void ActivityExportReader::close()
+{
+    d->file.close();
+    d->user.clear();
+    d->host.clear();
+    d->pendingLine.clear();
+}
+
+QString ActivityExportReader::path() const
+{
+    return d->file.fileName();
+}
+
+QString ActivityExportReader::user() const
+{
+    return d->user;
+}
+
+QString ActivityExportReader::host() const
+{
+    return d->host;
+}
+
+bool ActivityExportReader::read(ActivityExportRecord *record)
+{
+    while (!d->pendingLine.isEmpty() || !d->file.atEnd()) {
+        QByteArray line;
+        if (d->pendingLine.isEmpty()) {
+            line = d->file.readLine();
+        } else {
+            line.swap(d->pendingLine);
+        }
+
+        if (line.endsWith('\n')) {
+            line.chop(1);
+        }
+
+        const int startEnd = line.indexOf('\t');
+        const int secondsEnd = line.indexOf('\t', startEnd + 1);
+        if (startEnd < 0 || secondsEnd < 0) {
+            continue;
+        }
+
+        bool startOk, secondsOk;
+        record->start = line.left(startEnd).toLongLong(&startOk);
+        record->seconds = line.mid(startEnd + 1, secondsEnd - startEnd - 1).toUInt(&secondsOk);
+        if (!startOk || !secondsOk) {
+            continue;
+        }
+
+        const int userEnd = line.indexOf('\t', secondsEnd + 1);
+        if (userEnd < 0) {
+            continue;
+        }
+        record->user = QString::fromUtf8(line.mid(secondsEnd + 1, userEnd - secondsEnd - 1));
+
+        if (record->user.isEmpty()) {
+            record->user = d->user;
+        }
+
+        record->activity = QString::fromUtf8(line.mid(userEnd + 1));
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,93 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_EXPORT_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_EXPORT_H
+
+#include <QString>
+
+/*                          ActivityExport                                 *
+ * ----------------------------------------------------------------------- */
+
+// Portable text form of a history used to move it between machines. A few
+// header lines name the user and host, followed by one interval per line
+// sorted by start:
+//
+//     # plasma-timekeeper export 2
+//     # user jdoe
+//     # host workstation
+//     <start msecs since epoch, UTC>\t<seconds>\t<user>\t<activity>
+//
+// The user column is empty for intervals of the user in the header, only
+// exports of merged histories fill it.
+// Both the writer and the reader stream, so they work with constant memory
+// no matter how large the history is.
+struct ActivityExportRecord {
+    qint64 start;
+    quint32 seconds;
+    QString activity;
+    // Written empty for the user of the export, read back as that user
+    QString user;
+};
+
+class ActivityExportWriter
+{
+public:
+    ActivityExportWriter();
+    ~ActivityExportWriter();
+
+    // An empty path writes to the standard output
+    bool open(const QString &path, const QString &user, const QString &host);
+    void close();
+
+    bool write(const ActivityExportRecord &record);
+
+private:
+    Q_DISABLE_COPY(ActivityExportWriter)
+
+    class Private;
+    Private *const d;
+};
+
+class ActivityExportReader
+{
+public:
+    ActivityExportReader();
+    ~ActivityExportReader();
+
+    bool open(const QString &path);
+    void close();
+
+    QString path() const;
+    QString user() const;
+    QString host() const;
+
+    // Returns false at the end of the export, malformed lines are skipped.
+    // Records without a user get the one of the export.
+    bool read(ActivityExportRecord *record);
+
+private:
+    Q_DISABLE_COPY(ActivityExportReader)
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_EXPORT_H
@@ -0,0 +1,570 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityhistory.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLockFile>
+#include <QScopedPointer>
+#include <QStandardPaths>
+#include <QVector>
+
+#include <algorithm>
+#include <cstring>
+
+#include <sys/stat.h>
+
+static const char HISTORY_MAGIC[8] = { 'T', 'K', 'H', 'I', 'S', 'T', 0, 0 };
+static const quint32 HISTORY_VERSION = 2;
+
+struct HistoryHeader {
+    char magic[8];
+    quint32 version;
+    quint32 reserved;
+};
+
+const quint32 ActivityHistory::NoUser;
+const quint32 ActivityHistory::LongIntervalSeconds;
+
+Q_STATIC_ASSERT(sizeof(ActivityHistory::Interval) == 24);
+
+/*                     ActivityHistory::Private                            *
+ * ----------------------------------------------------------------------- */
+class ActivityHistory::Private
+{
+public:
+    // File with one entry per line, appended to by every writer
+    struct Table {
+        Table()
+            : offset(0),
+              loaded(false)
+        { }
+
+        bool index(const QString &entry, quint32 *index);
+        void readNew();
+        void close();
+
+        QString path;
+        QFile file;
+        QHash<QString, quint32> indexes;
+        // Part of the file already in indexes
+        qint64 offset;
+        bool loaded;
+    };
+
+    // File with one entry per line, read as far as it has grown
+    struct Lines {
+        Lines()
+            : offset(0),
+              complete(0)
+        { }
+
+        void readNew(const QString &path);
+        void clear();
+
+        QStringList lines;
+        // Part of the file with complete lines, and their count
+        qint64 offset;
+        int complete;
+    };
+
+    Private()
+        : lockTimeout(1000),
+          buffered(false),
+          map(0),
+          mapSize(0),
+          records(0),
+          count(0),
+          maximumSeconds(0)
+    { }
+
+    bool openForWriting();
+    bool lock();
+    bool unlock();
+    bool replaced(const QFile &file) const;
+    void indexIntervals(qint64 from);
+
+    QString path;
+
+    // Writing, the applet and the merge tool may append at the same time
+    QFile writeFile;
+    Table names;
+    Table users;
+    QScopedPointer<QLockFile> lockFile;
+    int lockTimeout;
+    bool buffered;
+
+    // Reading
+    QFile readFile;
+    uchar *map;
+    qint64 mapSize;
+    const Interval *records;
+    qint64 count;
+    Lines activities;
+    Lines userNames;
+    quint32 maximumSeconds;
+    QVector<qint64> longIntervals;
+};
+
+bool ActivityHistory::Private::Table::index(const QString &entry, quint32 *index)
+{
+    if (!file.isOpen()) {
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadWrite | QIODevice::Append)) {
+            return false;
+        }
+    }
+
+    readNew();
+
+    auto it = indexes.constFind(entry);
+    if (it == indexes.constEnd()) {
+        const QByteArray line = (entry + QLatin1Char('\n')).toUtf8();
+        if (file.write(line) != line.size()) {
+            return false;
+        }
+        offset += line.size();
+        it = indexes.insert(entry, indexes.count());
+    }
+
+    *index = *it;
+    return true;
+}
+
+void ActivityHistory::Private::Table::readNew()
+{
+    // Other writers may have added entries since we last looked
+    const qint64 size = file.size();
+    if (loaded && size == offset) {
+        return;
+    }
+
+    // Truncated since we last looked, start over
+    if (size < offset) {
+        loaded = false;
+    }
+
+    if (!loaded) {
+        indexes.clear();
+        offset = 0;
+        loaded = true;
+    }
+
+    file.seek(offset);
+    QByteArray data = file.read(size - offset);
+    offset += data.size();
+
+    // Readers count an unterminated line left by a crashed writer as an entry too
+    if (!data.isEmpty() && !data.endsWith('\n')) {
+        offset += file.write("\n");
+        data += '\n';
+    }
+
+    int lineStart = 0;
+    for (int lineEnd = data.indexOf('\n'); lineEnd >= 0; lineEnd = data.indexOf('\n', lineStart)) {
+        indexes.insert(QString::fromUtf8(data.constData() + lineStart, lineEnd - lineStart), indexes.count());
+        lineStart = lineEnd + 1;
+    }
+}
+
+void ActivityHistory::Private::Table::close()
+{
+    file.close();
+    indexes.clear();
+    offset = 0;
+    loaded = false;
+}
+
+void ActivityHistory::Private::Lines::readNew(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < offset) {
+        return;
+    }
+
+    // An unterminated line was read last time, it may be complete by now
+    lines.erase(lines.begin() + complete, lines.end());
+
+    file.seek(offset);
+    const QByteArray data = file.readAll();
+
+    int lineStart = 0;
+    for (int lineEnd = data.indexOf('\n'); lineEnd >= 0; lineEnd = data.indexOf('\n', lineStart)) {
+        lines << QString::fromUtf8(data.constData() + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+    }
+
+    offset += lineStart;
+    complete = lines.count();
+
+    // A line left by a crashed writer is an entry too, the next writer terminates it
+    if (lineStart < data.size()) {
+        lines << QString::fromUtf8(data.constData() + lineStart, data.size() - lineStart);
+    }
+}
+
+void ActivityHistory::Private::Lines::clear()
+{
+    lines.clear();
+    offset = 0;
+    complete = 0;
+}
+
+bool ActivityHistory::Private::openForWriting()
+{
+    if (writeFile.isOpen()) {
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // Append makes every write land at the current end, even if another
+    // writer has grown the file since we opened it
+    writeFile.setFileName(path);
+    if (!writeFile.open(QIODevice::ReadWrite | QIODevice::Append)) {
+        return false;
+    }
+
+    names.path = path + QStringLiteral(".names");
+    users.path = path + QStringLiteral(".users");
+
+    if (!lockFile) {
+        lockFile.reset(new QLockFile(path + QStringLiteral(".lock")));
+        // A buffered writer holds the lock for its whole session, only a dead owner makes it stale
+        lockFile->setStaleLockTime(0);
+    }
+
+    return true;
+}
+
+bool ActivityHistory::Private::replaced(const QFile &file) const
+{
+    struct stat pathStat, fileStat;
+    if (stat(QFile::encodeName(path).constData(), &pathStat) != 0 || fstat(file.handle(), &fileStat) != 0) {
+        return true;
+    }
+
+    return pathStat.st_dev != fileStat.st_dev || pathStat.st_ino != fileStat.st_ino;
+}
+
+void ActivityHistory::Private::indexIntervals(qint64 from)
+{
+    for (qint64 i = from; i < count; i++) {
+        maximumSeconds = qMax(maximumSeconds, records[i].seconds);
+        if (records[i].seconds > LongIntervalSeconds) {
+            longIntervals << i;
+        }
+    }
+}
+
+bool ActivityHistory::Private::lock()
+{
+    if (lockFile->isLocked()) {
+        return true;
+    }
+
+    if (!lockFile->tryLock(lockTimeout)) {
+        return false;
+    }
+
+    // Renamed over by another writer, e.g. a merge
+    if (replaced(writeFile)) {
+        writeFile.close();
+        names.close();
+        users.close();
+        if (!writeFile.open(QIODevice::ReadWrite | QIODevice::Append)) {
+            lockFile->unlock();
+            return false;
+        }
+    }
+
+    if (writeFile.size() < qint64(sizeof(HistoryHeader))) {
+        HistoryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, HISTORY_MAGIC, sizeof(header.magic));
+        header.version = HISTORY_VERSION;
+
+        writeFile.resize(0);
+        writeFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        return true;
+    }
+
+    HistoryHeader header;
+    writeFile.seek(0);
+    if (writeFile.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+        || memcmp(header.magic, HISTORY_MAGIC, sizeof(header.magic)) != 0
+        || header.version != HISTORY_VERSION) {
+        lockFile->unlock();
+        return false;
+    }
+
+    // Drop a partially written record, e.g. after a crash
+    const qint64 records = (writeFile.size() - sizeof(HistoryHeader)) / sizeof(Interval);
+    writeFile.resize(sizeof(HistoryHeader) + records * sizeof(Interval));
+
+    return true;
+}
+
+bool ActivityHistory::Private::unlock()
+{
+    if (!lockFile || !lockFile->isLocked()) {
+        return true;
+    }
+
+    // The names must reach the disk before the records referencing them
+    const bool flushed = (!names.file.isOpen() || names.file.flush())
+                      && (!users.file.isOpen() || users.file.flush())
+                      && writeFile.flush();
+    lockFile->unlock();
+
+    return flushed;
+}
+
+/*                          ActivityHistory                                *
+ * ----------------------------------------------------------------------- */
+
+QString ActivityHistory::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/plasma-timekeeper/history");
+}
+
+ActivityHistory::ActivityHistory(const QString &path)
+    : d(new Private())
+{
+    d->path = path;
+}
+
+ActivityHistory::~ActivityHistory()
+{
+    close();
+    delete d;
+}
+
+QString ActivityHistory::path() const
+{
+    return d->path;
+}
+
+bool ActivityHistory::append(const QString &activity, const QDateTime &start, int seconds, const QString &user)
+{
+    if (seconds <= 0 || !d->openForWriting() || !d->lock()) {
+        return false;
+    }
+
+    QString name = activity;
+    name.replace(QLatin1Char('\n'), QLatin1Char(' '));
+
+    QString userName = user;
+    userName.replace(QLatin1Char('\n'), QLatin1Char(' '));
+
+    Interval interval;
+    interval.start = start.toMSecsSinceEpoch();
+    interval.seconds = seconds;
+    interval.user = NoUser;
+    interval.reserved = 0;
+
+    if (!d->names.index(name, &interval.activity) || (!userName.isEmpty() && !d->users.index(userName, &interval.user))
+        || d->writeFile.write(reinterpret_cast<const char *>(&interval), sizeof(interval)) != sizeof(interval)) {
+        d->unlock();
+        return false;
+    }
+
+    return d->buffered || d->unlock();
+}
+
+void ActivityHistory::setLockTimeout(int msecs)
+{
+    d->lockTimeout = msecs;
+}
+
+void ActivityHistory::setBuffered(bool buffered)
+{
+    d->buffered = buffered;
+    if (!buffered) {
+        d->unlock();
+    }
+}
+
+bool ActivityHistory::open()
+{
+    close();
+
+    d->readFile.setFileName(d->path);
+    if (!d->readFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = d->readFile.size();
+    if (size < qint64(sizeof(HistoryHeader))) {
+        d->readFile.close();
+        return false;
+    }
+
+    d->map = d->readFile.map(0, size);
+    if (!d->map) {
+        d->readFile.close();
+        return false;
+    }
+    d->mapSize = size;
+
+    const HistoryHeader *header = reinterpret_cast<const HistoryHeader *>(d->map);
+    if (memcmp(header->magic, HISTORY_MAGIC, sizeof(header->magic)) != 0 || header->version != HISTORY_VERSION) {
+        close();
+        return false;
+    }
+
+    d->records = reinterpret_cast<const Interval *>(d->map + sizeof(HistoryHeader));
+    d->count = (size - sizeof(HistoryHeader)) / sizeof(Interval);
+
+    d->activities.readNew(d->path + QStringLiteral(".names"));
+    d->userNames.readNew(d->path + QStringLiteral(".users"));
+    d->indexIntervals(0);
+
+    return true;
+}
+
+bool ActivityHistory::refresh(bool *reopened)
+{
+    if (reopened) {
+        *reopened = false;
+    }
+
+    if (!isOpen() || d->replaced(d->readFile)) {
+        if (reopened) {
+            *reopened = true;
+        }
+        return open();
+    }
+
+    const qint64 size = d->readFile.size();
+    if (size <= d->mapSize) {
+        return false;
+    }
+
+    // Mapping again costs the same however long the history is, only the new
+    // intervals and names are read
+    d->readFile.unmap(d->map);
+    d->map = d->readFile.map(0, size);
+    if (!d->map) {
+        close();
+        return false;
+    }
+    d->mapSize = size;
+
+    const qint64 oldCount = d->count;
+    d->records = reinterpret_cast<const Interval *>(d->map + sizeof(HistoryHeader));
+    d->count = (size - sizeof(HistoryHeader)) / sizeof(Interval);
+
+    d->activities.readNew(d->path + QStringLiteral(".names"));
+    d->userNames.readNew(d->path + QStringLiteral(".users"));
+    d->indexIntervals(oldCount);
+
+    return d->count > oldCount;
+}
+
+void ActivityHistory::close()
+{
+    d->unlock();
+    d->writeFile.close();
+    d->names.close();
+    d->users.close();
+
+    if (d->map) {
+        d->readFile.unmap(d->map);
+        d->map = 0;
+    }
+    d->mapSize = 0;
+
+    d->readFile.close();
+    d->records = 0;
+    d->count = 0;
+    d->activities.clear();
+    d->userNames.clear();
+    d->maximumSeconds = 0;
+    d->longIntervals.clear();
+}
+
+bool ActivityHistory::isOpen() const
+{
+    return d->records;
+}
+
+const ActivityHistory::Interval *ActivityHistory::intervals() const
+{
+    return d->records;
+}
+
+qint64 ActivityHistory::count() const
+{
+    return d->count;
+}
+
+QStringList ActivityHistory::activities() const
+{
+    return d->activities.lines;
+}
+
+QStringList ActivityHistory::users() const
+{
+    return d->userNames.lines;
+}
+
+qint64 ActivityHistory::lowerBound(qint64 start) const
+{
+    const Interval *begin = intervals();
+    if (!begin) {
+        return 0;
+    }
+
+    const Interval *it = std::lower_bound(begin, begin + d->count, start, [] (const Interval &interval, qint64 value) {
+        return interval.start < value;
+    });
+
+    return it - begin;
+}
+
+quint32 ActivityHistory::maximumSeconds() const
+{
+    return d->maximumSeconds;
+}
+
+qint64 ActivityHistory::firstIntersecting(qint64 from, QVector<qint64> *earlier) const
+{
+    earlier->clear();
+
+    const qint64 first = lowerBound(from - qint64(qMin(d->maximumSeconds, LongIntervalSeconds)) * 1000);
+
+    // Long intervals are ascending by start as well, none starting before this reaches the range
+    const qint64 lookBack = from - qint64(d->maximumSeconds) * 1000;
+    auto it = std::lower_bound(d->longIntervals.constBegin(), d->longIntervals.constEnd(), lookBack, [this] (qint64 index, qint64 value) {
+        return d->records[index].start < value;
+    });
+
+    for (; it != d->longIntervals.constEnd() && *it < first; ++it) {
+        if (d->records[*it].start + qint64(d->records[*it].seconds) * 1000 > from) {
+            *earlier << *it;
+        }
+    }
+
+    return first;
+}
@@ -0,0 +1,107 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_HISTORY_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_HISTORY_H
+
+#include <QDateTime>
+#include <QStringList>
+#include <QVector>
+
+/*                          ActivityHistory                                *
+ * ----------------------------------------------------------------------- */
+
+// Append-only history of tracked intervals. It consists of the history itself
+// with fixed-size interval records sorted by their start, a ".names" file with
+// one activity name per line and a ".users" file with one user per line, both
+// referenced by the records by line number. Only histories merged from several
+// users have the latter. Fixed-size records allow to map the history and scan
+// it without parsing.
+class ActivityHistory
+{
+public:
+    struct Interval {
+        // Milliseconds since epoch, UTC
+        qint64 start;
+        quint32 seconds;
+        quint32 activity;
+        // NoUser in the history of the user running the applet
+        quint32 user;
+        quint32 reserved;
+    };
+
+    static const quint32 NoUser = 0xffffffff;
+
+    // Intervals longer than this are indexed apart from the others
+    static const quint32 LongIntervalSeconds = 3600;
+
+    static QString defaultPath();
+
+    explicit ActivityHistory(const QString &path = defaultPath());
+    ~ActivityHistory();
+
+    QString path() const;
+
+    // Writing, every interval is flushed right away unless buffered. Appends are
+    // serialized with other processes by a lock file, a buffered writer keeps it
+    // until it is closed or stops buffering.
+    bool append(const QString &activity, const QDateTime &start, int seconds, const QString &user = QString());
+    void setBuffered(bool buffered);
+
+    // Milliseconds an append waits for the lock held by another writer, one second
+    // by default. With 0 it fails right away and can be retried later.
+    void setLockTimeout(int msecs);
+
+    // Reading, maps the history read-only
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    // Maps the intervals appended since, opens the history again if it was
+    // replaced meanwhile. Returns whether there is anything new, reopened tells
+    // whether that is only the appended intervals or the whole history.
+    bool refresh(bool *reopened = 0);
+
+    const Interval *intervals() const;
+    qint64 count() const;
+    QStringList activities() const;
+    QStringList users() const;
+
+    // Index of the first interval starting at or after the given time
+    qint64 lowerBound(qint64 start) const;
+
+    // Longest interval, intervals intersecting a range start at most this long before it
+    quint32 maximumSeconds() const;
+
+    // Intervals intersecting a range starting at the given time are the ones
+    // from the returned index on, plus the long ones put into earlier. Short
+    // intervals start at most LongIntervalSeconds before the range, the long
+    // ones further back are indexed apart, so a single long interval doesn't
+    // make every range scan that far back.
+    qint64 firstIntersecting(qint64 from, QVector<qint64> *earlier) const;
+
+private:
+    Q_DISABLE_COPY(ActivityHistory)
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_HISTORY_H
@@ -0,0 +1,282 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitymerger.h"
+#include "activityexport.h"
+#include "activityhistory.h"
+
+#include <QFile>
+#include <QHash>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <vector>
+
+// Next record of one input, the queue always holds at most one per input
+struct Head {
+    qint64 start;
+    int input;
+};
+
+struct HeadGreater {
+    bool operator()(const Head &left, const Head &right) const
+    {
+        return left.start > right.start || (left.start == right.start && left.input > right.input);
+    }
+};
+
+static bool replaceFile(const QString &from, const QString &to)
+{
+    // Unlike QFile::rename() this replaces the target atomically
+    return rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+}
+
+/*                      ActivityMerger::Private                            *
+ * ----------------------------------------------------------------------- */
+class ActivityMerger::Private
+{
+public:
+    Private()
+        : merged(0),
+          trimmed(0),
+          sortedExports(0)
+    { }
+
+    // Path of the export to merge, a sorted copy if it isn't sorted
+    bool prepare(const QString &path, QString *sortedPath);
+    bool mergeInto(const QStringList &exports, ActivityHistory *history);
+
+    QString errorString;
+    qint64 merged;
+    qint64 trimmed;
+    int sortedExports;
+
+    std::vector<std::unique_ptr<QTemporaryFile> > sortedFiles;
+};
+
+bool ActivityMerger::Private::prepare(const QString &path, QString *sortedPath)
+{
+    ActivityExportReader reader;
+    if (!reader.open(path)) {
+        errorString = QStringLiteral("Can't read export %1").arg(path);
+        return false;
+    }
+
+    ActivityExportRecord record;
+    qint64 previousStart = std::numeric_limits<qint64>::min();
+    bool sorted = true;
+    while (sorted && reader.read(&record)) {
+        sorted = record.start >= previousStart;
+        previousStart = record.start;
+    }
+
+    if (sorted) {
+        *sortedPath = path;
+        return true;
+    }
+
+    // Exports are written sorted, only hand-edited or concatenated ones get here
+    QVector<ActivityExportRecord> records;
+    reader.open(path);
+    while (reader.read(&record)) {
+        records << record;
+    }
+
+    std::stable_sort(records.begin(), records.end(), [] (const ActivityExportRecord &left, const ActivityExportRecord &right) {
+        return left.start < right.start;
+    });
+
+    std::unique_ptr<QTemporaryFile> sortedFile(new QTemporaryFile());
+    ActivityExportWriter writer;
+    if (!sortedFile->open() || !writer.open(sortedFile->fileName(), reader.user(), reader.host())) {
+        errorString = QStringLiteral("Can't sort export %1").arg(path);
+        return false;
+    }
+
+    foreach (const ActivityExportRecord &sortedRecord, records) {
+        if (!writer.write(sortedRecord)) {
+            errorString = QStringLiteral("Can't sort export %1").arg(path);
+            return false;
+        }
+    }
+
+    writer.close();
+    *sortedPath = sortedFile->fileName();
+    sortedFiles.push_back(std::move(sortedFile));
+    sortedExports++;
+
+    return true;
+}
+
+bool ActivityMerger::Private::mergeInto(const QStringList &exports, ActivityHistory *history)
+{
+    std::vector<std::unique_ptr<ActivityExportReader> > readers;
+    QVector<ActivityExportRecord> records(exports.count());
+    std::priority_queue<Head, std::vector<Head>, HeadGreater> queue;
+
+    foreach (const QString &path, exports) {
+        std::unique_ptr<ActivityExportReader> reader(new ActivityExportReader());
+        if (!reader->open(path)) {
+            errorString = QStringLiteral("Can't read export %1").arg(path);
+            return false;
+        }
+
+        const int input = readers.size();
+        if (reader->read(&records[input])) {
+            queue.push({ records[input].start, input });
+        }
+        readers.push_back(std::move(reader));
+    }
+
+    // End of the last merged interval per user, later intervals overlapping it
+    // are trimmed so time recorded twice counts once
+    QHash<QString, qint64> userEnds;
+
+    while (!queue.empty()) {
+        const Head head = queue.top();
+        queue.pop();
+
+        ActivityExportRecord &record = records[head.input];
+
+        const qint64 end = record.start + qint64(record.seconds) * 1000;
+        auto userEnd = userEnds.find(record.user);
+        if (userEnd == userEnds.end()) {
+            userEnd = userEnds.insert(record.user, end);
+        } else if (record.start < *userEnd) {
+            const qint64 seconds = (end - *userEnd) / 1000;
+            record.start = *userEnd;
+            record.seconds = qMax<qint64>(seconds, 0);
+            trimmed++;
+        }
+
+        if (record.seconds > 0) {
+            if (!history->append(record.activity, QDateTime::fromMSecsSinceEpoch(record.start, Qt::UTC), record.seconds, record.user)) {
+                errorString = QStringLiteral("Can't write history %1").arg(history->path());
+                return false;
+            }
+            *userEnd = qMax(*userEnd, record.start + qint64(record.seconds) * 1000);
+            merged++;
+        }
+
+        if (readers[head.input]->read(&record)) {
+            queue.push({ record.start, head.input });
+        }
+    }
+
+    return true;
+}
+
+/*                           ActivityMerger                                *
+ * ----------------------------------------------------------------------- */
+
+ActivityMerger::ActivityMerger()
+    : d(new Private())
+{
+}
+
+ActivityMerger::~ActivityMerger()
+{
+    delete d;
+}
+
+bool ActivityMerger::merge(const QStringList &exports, const QString &outputPath)
+{
+    d->errorString.clear();
+    d->merged = 0;
+    d->trimmed = 0;
+    d->sortedExports = 0;
+    d->sortedFiles.clear();
+
+    QStringList sortedExports;
+    foreach (const QString &path, exports) {
+        QString sortedPath;
+        if (!d->prepare(path, &sortedPath)) {
+            return false;
+        }
+        sortedExports << sortedPath;
+    }
+
+    // Written next to the output so it can be renamed over it
+    QTemporaryFile output(outputPath + QStringLiteral(".XXXXXX"));
+    if (!output.open()) {
+        d->errorString = QStringLiteral("Can't write history %1").arg(outputPath);
+        return false;
+    }
+    output.close();
+
+    const QString namesPath = output.fileName() + QStringLiteral(".names");
+    const QString usersPath = output.fileName() + QStringLiteral(".users");
+
+    ActivityHistory history(output.fileName());
+    history.setBuffered(true);
+    const bool merged = d->mergeInto(sortedExports, &history);
+    history.close();
+    d->sortedFiles.clear();
+
+    if (!merged) {
+        QFile::remove(namesPath);
+        QFile::remove(usersPath);
+        return false;
+    }
+
+    if (!QFile::exists(usersPath)) {
+        QFile::remove(outputPath + QStringLiteral(".users"));
+    }
+
+    // The history goes last, it references the other two
+    if ((QFile::exists(namesPath) && !replaceFile(namesPath, outputPath + QStringLiteral(".names")))
+        || (QFile::exists(usersPath) && !replaceFile(usersPath, outputPath + QStringLiteral(".users")))
+        || !replaceFile(output.fileName(), outputPath)) {
+        d->errorString = QStringLiteral("Can't replace history %1").arg(outputPath);
+        QFile::remove(namesPath);
+        QFile::remove(usersPath);
+        return false;
+    }
+
+    output.setAutoRemove(false);
+    return true;
+}
+
+QString ActivityMerger::errorString() const
+{
+    return d->errorString;
+}
+
+qint64 ActivityMerger::merged() const
+{
+    return d->merged;
+}
+
+qint64 ActivityMerger::trimmed() const
+{
+    return d->trimmed;
+}
+
+int ActivityMerger::sortedExports() const
+{
+    return d->sortedExports;
+}
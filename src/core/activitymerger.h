@@ -0,0 +1,55 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_MERGER_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_MERGER_H
+
+#include <QStringList>
+
+/*                           ActivityMerger                                *
+ * ----------------------------------------------------------------------- */
+
+// Merges exports of several users and machines into one history, keeping the
+// user of every interval. Exports are merged in a single streaming pass, those
+// not sorted by start are sorted into a temporary export first. Time a user
+// recorded twice, e.g. an export merged again, counts once.
+class ActivityMerger
+{
+public:
+    ActivityMerger();
+    ~ActivityMerger();
+
+    // The output is replaced only once all exports were merged
+    bool merge(const QStringList &exports, const QString &outputPath);
+
+    QString errorString() const;
+
+    qint64 merged() const;
+    qint64 trimmed() const;
+    int sortedExports() const;
+
+private:
+    Q_DISABLE_COPY(ActivityMerger)
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_MERGER_H
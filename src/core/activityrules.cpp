@@ -0,0 +1,368 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityrules.h"
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QVector>
+#include <QtDebug>
+
+/*                        ActivityRules::Private                           *
+ * ----------------------------------------------------------------------- */
+class ActivityRules::Private
+{
+public:
+    enum Action {
+        IgnoreAction = 0,
+        RenameAction,
+        CategoryAction,
+        ActionCount
+    };
+
+    enum Syntax {
+        ExactSyntax,
+        GlobSyntax,
+        RegexSyntax
+    };
+
+    struct Rule {
+        Action action;
+        Syntax syntax;
+        QString pattern;
+        QString value;
+    };
+
+    // Exact patterns are looked up in a hash, glob and regex patterns are joined
+    // into one alternation where every rule has its own named group. Patterns
+    // referring to their own groups can't be joined and are matched one by one.
+    struct Matcher {
+        QHash<QString, int> exactRules;
+        QVector<int> regexRules;
+        QRegularExpression regex;
+        QVector<int> separateRules;
+        QVector<QRegularExpression> separateRegexes;
+    };
+
+    static bool parseRule(const QString &line, Rule *rule);
+    static QString globToRegularExpression(const QString &glob);
+    static bool canJoin(const QString &pattern);
+
+    int matchRule(const Matcher &matcher, const QString &windowClass) const;
+
+    QStringList ruleLines;
+
+    QVector<Rule> rules;
+    Matcher matchers[ActionCount];
+
+    mutable QHash<QString, Result> cache;
+};
+
+bool ActivityRules::Private::parseRule(const QString &line, Rule *rule)
+{
+    const QString simplified = line.simplified();
+    if (simplified.isEmpty() || simplified.startsWith(QLatin1Char('#'))) {
+        return false;
+    }
+
+    const QStringList fields = simplified.split(QLatin1Char(' '));
+    if (fields.count() < 3) {
+        return false;
+    }
+
+    const QString action = fields.at(0).toLower();
+    if (action == QLatin1String("ignore")) {
+        rule->action = IgnoreAction;
+    } else if (action == QLatin1String("rename")) {
+        rule->action = RenameAction;
+    } else if (action == QLatin1String("category")) {
+        rule->action = CategoryAction;
+    } else {
+        return false;
+    }
+
+    const QString syntax = fields.at(1).toLower();
+    if (syntax == QLatin1String("exact")) {
+        rule->syntax = ExactSyntax;
+    } else if (syntax == QLatin1String("glob")) {
+        rule->syntax = GlobSyntax;
+    } else if (syntax == QLatin1String("regex")) {
+        rule->syntax = RegexSyntax;
+    } else {
+        return false;
+    }
+
+    rule->pattern = fields.at(2);
+    rule->value = QStringList(fields.mid(3)).join(QLatin1Char(' '));
+
+    // Rename and category rules need something to rename or categorize to
+    return rule->action == IgnoreAction || !rule->value.isEmpty();
+}
+
+QString ActivityRules::Private::globToRegularExpression(const QString &glob)
+{
+    QString regex;
+    regex.reserve(glob.size() * 2);
+
+    bool inBrackets = false;
+    foreach (const QChar &c, glob) {
+        if (inBrackets) {
+            if (c == QLatin1Char(']')) {
+                inBrackets = false;
+            }
+            regex += c;
+        } else if (c == QLatin1Char('*')) {
+            regex += QLatin1String(".*");
+        } else if (c == QLatin1Char('?')) {
+            regex += QLatin1Char('.');
+        } else if (c == QLatin1Char('[')) {
+            inBrackets = true;
+            regex += c;
+        } else {
+            regex += QRegularExpression::escape(QString(c));
+        }
+    }
+
+    // Unterminated bracket, treat it literally
+    if (inBrackets) {
+        return QRegularExpression::escape(glob);
+    }
+
+    return regex;
+}
+
+bool ActivityRules::Private::canJoin(const QString &pattern)
+{
+    // Backreferences, subroutine calls and conditions refer to groups by number or
+    // by name. Numbers change once the pattern is part of the alternation and names
+    // could clash with the ones of the other rules, so neither may appear.
+    for (int i = 0; i + 1 < pattern.length(); i++) {
+        const QChar c = pattern.at(i);
+        const QChar next = pattern.at(i + 1);
+
+        if (c == QLatin1Char('\\')) {
+            if (next.isDigit() || next == QLatin1Char('g') || next == QLatin1Char('k')) {
+                return false;
+            }
+            i++;
+        } else if (c == QLatin1Char('(') && next == QLatin1Char('?') && i + 2 < pattern.length()) {
+            const QChar kind = pattern.at(i + 2);
+            const QChar after = i + 3 < pattern.length() ? pattern.at(i + 3) : QChar();
+
+            // Lookbehinds are fine, named groups are not
+            if (kind == QLatin1Char('<') && after != QLatin1Char('=') && after != QLatin1Char('!')) {
+                return false;
+            }
+            if (kind == QLatin1Char('\'') || kind == QLatin1Char('P') || kind == QLatin1Char('&') || kind == QLatin1Char('(') ||
+                kind == QLatin1Char('R') || kind == QLatin1Char('|') || kind == QLatin1Char('+') || kind.isDigit() ||
+                (kind == QLatin1Char('-') && after.isDigit())) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+int ActivityRules::Private::matchRule(const Matcher &matcher, const QString &windowClass) const
+{
+    int rule = matcher.exactRules.value(windowClass, -1);
+
+    if (!matcher.regexRules.isEmpty()) {
+        const QRegularExpressionMatch match = matcher.regex.match(windowClass);
+
+        // Rule indexes are sorted so the first captured group is the first matching rule
+        if (match.hasMatch()) {
+            foreach (int regexRule, matcher.regexRules) {
+                if (rule >= 0 && regexRule > rule) {
+                    break;
+                }
+
+                if (match.capturedStart(QStringLiteral("r%1").arg(regexRule)) >= 0) {
+                    rule = regexRule;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < matcher.separateRules.count(); i++) {
+        if (rule >= 0 && matcher.separateRules.at(i) > rule) {
+            break;
+        }
+
+        if (matcher.separateRegexes.at(i).match(windowClass).hasMatch()) {
+            return matcher.separateRules.at(i);
+        }
+    }
+
+    return rule;
+}
+
+/*                          ActivityRules                                  *
+ * ----------------------------------------------------------------------- */
+
+ActivityRules::ActivityRules()
+    : d(new Private())
+{
+}
+
+ActivityRules::~ActivityRules()
+{
+    delete d;
+}
+
+void ActivityRules::setRules(const QStringList &rules)
+{
+    if (d->ruleLines == rules) {
+        return;
+    }
+
+    d->ruleLines = rules;
+    compile();
+}
+
+QStringList ActivityRules::rules() const
+{
+    return d->ruleLines;
+}
+
+void ActivityRules::clearCache()
+{
+    d->cache.clear();
+}
+
+QString ActivityRules::ignoreRule(const QString &name)
+{
+    bool hasSpace = false;
+    foreach (const QChar &c, name) {
+        hasSpace = hasSpace || c.isSpace();
+    }
+
+    if (!hasSpace) {
+        return QStringLiteral("ignore exact ") + name;
+    }
+
+    // Fields are separated by whitespace, so it is spelled out in a regex
+    QString pattern;
+    foreach (const QChar &c, name) {
+        pattern += c.isSpace() ? QStringLiteral("\\x{%1}").arg(c.unicode(), 0, 16) : QRegularExpression::escape(QString(c));
+    }
+
+    return QStringLiteral("ignore regex ") + pattern;
+}
+
+ActivityRules::Result ActivityRules::match(const QString &windowClass) const
+{
+    auto it = d->cache.constFind(windowClass);
+    if (it != d->cache.constEnd()) {
+        return *it;
+    }
+
+    Result result;
+    result.ignored = d->matchRule(d->matchers[Private::IgnoreAction], windowClass) >= 0;
+    result.name = windowClass;
+
+    if (!result.ignored) {
+        const int renameRule = d->matchRule(d->matchers[Private::RenameAction], windowClass);
+        if (renameRule >= 0) {
+            result.name = d->rules.at(renameRule).value;
+            // Activities ignored from the applet are ignored under their shown name
+            result.ignored = d->matchRule(d->matchers[Private::IgnoreAction], result.name) >= 0;
+        }
+    }
+
+    if (!result.ignored) {
+        int categoryRule = d->matchRule(d->matchers[Private::CategoryAction], windowClass);
+        if (categoryRule < 0 && result.name != windowClass) {
+            categoryRule = d->matchRule(d->matchers[Private::CategoryAction], result.name);
+        }
+        if (categoryRule >= 0) {
+            result.category = d->rules.at(categoryRule).value;
+        }
+    }
+
+    // Window classes come and go over a long session, so the cache starts over once it gets large
+    if (d->cache.count() >= 1024) {
+        d->cache.clear();
+    }
+    d->cache.insert(windowClass, result);
+
+    return result;
+}
+
+void ActivityRules::compile()
+{
+    d->rules.clear();
+    d->cache.clear();
+
+    QStringList alternatives[Private::ActionCount];
+    for (int action = 0; action < Private::ActionCount; action++) {
+        d->matchers[action] = Private::Matcher();
+    }
+
+    foreach (const QString &line, d->ruleLines) {
+        Private::Rule rule;
+        if (!Private::parseRule(line, &rule)) {
+            if (!line.trimmed().isEmpty() && !line.trimmed().startsWith(QLatin1Char('#'))) {
+                qWarning() << "Ignoring malformed activity rule" << line;
+            }
+            continue;
+        }
+
+        const int index = d->rules.count();
+        d->rules << rule;
+
+        Private::Matcher &matcher = d->matchers[rule.action];
+        if (rule.syntax == Private::ExactSyntax) {
+            if (!matcher.exactRules.contains(rule.pattern)) {
+                matcher.exactRules.insert(rule.pattern, index);
+            }
+            continue;
+        }
+
+        const QString pattern = rule.syntax == Private::GlobSyntax ? Private::globToRegularExpression(rule.pattern) : rule.pattern;
+        if (!QRegularExpression(pattern).isValid()) {
+            qWarning() << "Ignoring activity rule with invalid pattern" << line;
+            continue;
+        }
+
+        if (!Private::canJoin(pattern)) {
+            QRegularExpression regex(QStringLiteral("^(?:%1)$").arg(pattern));
+            regex.optimize();
+            matcher.separateRules << index;
+            matcher.separateRegexes << regex;
+            continue;
+        }
+
+        alternatives[rule.action] << QStringLiteral("(?<r%1>%2)").arg(index).arg(pattern);
+        matcher.regexRules << index;
+    }
+
+    for (int action = 0; action < Private::ActionCount; action++) {
+        if (alternatives[action].isEmpty()) {
+            continue;
+        }
+
+        Private::Matcher &matcher = d->matchers[action];
+        matcher.regex.setPattern(QStringLiteral("^(?:%1)$").arg(alternatives[action].join(QLatin1Char('|'))));
+        matcher.regex.optimize();
+    }
+}
@@ -0,0 +1,73 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_RULES_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_RULES_H
+
+#include <QString>
+#include <QStringList>
+
+/*                          ActivityRules                                  *
+ * ----------------------------------------------------------------------- */
+
+// Ignore, rename and category rules applied to window classes. Each rule is
+// one line in the form "<action> <syntax> <pattern> [value]", e.g.
+//
+//     ignore glob org.kde.*
+//     rename regex .*-terminal Terminal
+//     category exact firefox Browsing
+//
+// where action is one of "ignore", "rename" or "category" and syntax one of
+// "exact", "glob" or "regex". Rules are compiled into one matcher per action
+// and the first matching rule wins. Ignore and category rules also match the
+// new name of renamed activities. Results are cached per window class.
+class ActivityRules
+{
+public:
+    struct Result {
+        bool ignored;
+        QString name;
+        QString category;
+    };
+
+    ActivityRules();
+    ~ActivityRules();
+
+    void setRules(const QStringList &rules);
+    QStringList rules() const;
+
+    Result match(const QString &windowClass) const;
+
+    // Drops the cached results
+    void clearCache();
+
+    // Rule ignoring exactly the given window class or activity name
+    static QString ignoreRule(const QString &name);
+
+private:
+    Q_DISABLE_COPY(ActivityRules)
+
+    void compile();
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_RULES_H
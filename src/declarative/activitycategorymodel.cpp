@@ -0,0 +1,370 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitycategorymodel.h"
+#include "durationformat.h"
+
+#include <KLocalizedString>
+
+#include <QPointer>
+#include <QVector>
+
+const static QString OTHER_APPLICATIONS_NAME = i18n("other applications");
+const static QString UNCATEGORIZED_NAME = i18n("Uncategorized");
+
+/*                   ActivityCategoryModel::Private                        *
+ * ----------------------------------------------------------------------- */
+class ActivityCategoryModel::Private
+{
+public:
+    Private()
+        : totalSeconds(0)
+    { }
+
+    struct SourceRow {
+        int category;
+        qint64 seconds;
+    };
+
+    struct Category {
+        QString name;
+        qint64 seconds;
+        int activityCount;
+    };
+
+    QString sourceCategory(int row) const;
+    qint64 sourceSeconds(int row) const;
+
+    QPointer<QAbstractItemModel> sourceModel;
+
+    // Mirrors rows of the source model
+    QVector<SourceRow> sourceRows;
+
+    QVector<Category> categories;
+    QHash<QString, int> categoryRows;
+
+    qint64 totalSeconds;
+};
+
+QString ActivityCategoryModel::Private::sourceCategory(int row) const
+{
+    const QModelIndex index = sourceModel->index(row, 0);
+    const QString category = sourceModel->data(index, ActivityModel::ActivityCategoryRole).toString();
+
+    if (category.isEmpty() || sourceModel->data(index, ActivityModel::ActivityNameRole).toString() == OTHER_APPLICATIONS_NAME) {
+        return UNCATEGORIZED_NAME;
+    }
+
+    return category;
+}
+
+qint64 ActivityCategoryModel::Private::sourceSeconds(int row) const
+{
+    return sourceModel->data(sourceModel->index(row, 0), ActivityModel::ActivitySecondsRole).toLongLong();
+}
+
+/*                       ActivityCategoryModel                             *
+ * ----------------------------------------------------------------------- */
+
+ActivityCategoryModel::ActivityCategoryModel(QObject *parent)
+    : QAbstractListModel(parent),
+      d(new Private())
+{
+}
+
+ActivityCategoryModel::~ActivityCategoryModel()
+{
+    delete d;
+}
+
+QAbstractItemModel *ActivityCategoryModel::sourceModel() const
+{
+    return d->sourceModel;
+}
+
+void ActivityCategoryModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (d->sourceModel == sourceModel) {
+        return;
+    }
+
+    if (d->sourceModel) {
+        disconnect(d->sourceModel, 0, this, 0);
+    }
+
+    d->sourceModel = sourceModel;
+
+    if (d->sourceModel) {
+        connect(d->sourceModel, &QAbstractItemModel::dataChanged, this, &ActivityCategoryModel::sourceDataChanged);
+        connect(d->sourceModel, &QAbstractItemModel::rowsInserted, this, &ActivityCategoryModel::sourceRowsInserted);
+        connect(d->sourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &ActivityCategoryModel::sourceRowsAboutToBeRemoved);
+        connect(d->sourceModel, &QAbstractItemModel::modelReset, this, &ActivityCategoryModel::sourceModelReset);
+        connect(d->sourceModel, &QAbstractItemModel::layoutChanged, this, &ActivityCategoryModel::sourceModelReset);
+        connect(d->sourceModel, &QAbstractItemModel::rowsMoved, this, &ActivityCategoryModel::sourceModelReset);
+    }
+
+    sourceModelReset();
+}
+
+QVariant ActivityCategoryModel::data(const QModelIndex &index, int role) const
+{
+    const int row = index.row();
+
+    if (row >= 0 && row < d->categories.count()) {
+        const Private::Category &category = d->categories.at(row);
+
+        switch (role) {
+            case CategoryNameRole:
+                return category.name;
+                break;
+            case CategoryTimeRole:
+                return formatDuration(category.seconds);
+                break;
+            case CategorySecondsRole:
+                return category.seconds;
+                break;
+            case CategoryPercentualUsageRole:
+                return d->totalSeconds ? int(category.seconds * 100 / d->totalSeconds) : 0;
+                break;
+            case CategoryActivityCountRole:
+                return category.activityCount;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return QVariant();
+}
+
+int ActivityCategoryModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return d->categories.count();
+}
+
+QHash< int, QByteArray > ActivityCategoryModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles[CategoryNameRole] = "CategoryName";
+    roles[CategoryTimeRole] = "CategoryTime";
+    roles[CategorySecondsRole] = "CategorySeconds";
+    roles[CategoryPercentualUsageRole] = "CategoryPercentualUsage";
+    roles[CategoryActivityCountRole] = "CategoryActivityCount";
+
+    return roles;
+}
+
+void ActivityCategoryModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    if (!roles.isEmpty() && !roles.contains(ActivityModel::ActivitySecondsRole) && !roles.contains(ActivityModel::ActivityTimeRole) &&
+        !roles.contains(ActivityModel::ActivityCategoryRole) && !roles.contains(ActivityModel::ActivityNameRole)) {
+        return;
+    }
+
+    const qint64 previousTotalSeconds = d->totalSeconds;
+    int firstChangedRow = d->categories.count();
+    int lastChangedRow = -1;
+
+    for (int row = topLeft.row(); row <= bottomRight.row() && row < d->sourceRows.count(); row++) {
+        Private::SourceRow &sourceRow = d->sourceRows[row];
+        const qint64 seconds = d->sourceSeconds(row);
+        const QString categoryName = d->sourceCategory(row);
+
+        if (d->categories.at(sourceRow.category).name == categoryName) {
+            if (seconds == sourceRow.seconds) {
+                continue;
+            }
+
+            d->categories[sourceRow.category].seconds += seconds - sourceRow.seconds;
+            d->totalSeconds += seconds - sourceRow.seconds;
+            sourceRow.seconds = seconds;
+            firstChangedRow = qMin(firstChangedRow, sourceRow.category);
+            lastChangedRow = qMax(lastChangedRow, sourceRow.category);
+            continue;
+        }
+
+        // Move the activity to its new category
+        const int previousCategory = sourceRow.category;
+        d->categories[previousCategory].seconds -= sourceRow.seconds;
+        d->categories[previousCategory].activityCount--;
+        d->totalSeconds -= sourceRow.seconds;
+
+        // The row is removed from its category before it's checked to be empty
+        sourceRow.category = -1;
+        removeCategoryRowIfEmpty(previousCategory);
+
+        const int category = categoryRow(categoryName);
+        d->sourceRows[row].category = category;
+        d->sourceRows[row].seconds = seconds;
+        d->categories[category].seconds += seconds;
+        d->categories[category].activityCount++;
+        d->totalSeconds += seconds;
+
+        firstChangedRow = 0;
+        lastChangedRow = d->categories.count() - 1;
+    }
+
+    if (d->categories.isEmpty()) {
+        return;
+    }
+
+    if (d->totalSeconds != previousTotalSeconds) {
+        // Percentual usage of every category depends on the total time
+        Q_EMIT dataChanged(index(0, 0), index(d->categories.count() - 1, 0));
+    } else if (lastChangedRow >= 0) {
+        Q_EMIT dataChanged(index(firstChangedRow, 0), index(lastChangedRow, 0));
+    }
+}
+
+void ActivityCategoryModel::sourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    const qint64 previousTotalSeconds = d->totalSeconds;
+
+    for (int row = first; row <= last; row++) {
+        const qint64 seconds = d->sourceSeconds(row);
+        const int category = categoryRow(d->sourceCategory(row));
+
+        Private::SourceRow sourceRow;
+        sourceRow.category = category;
+        sourceRow.seconds = seconds;
+        d->sourceRows.insert(row, sourceRow);
+
+        d->categories[category].seconds += seconds;
+        d->categories[category].activityCount++;
+        d->totalSeconds += seconds;
+    }
+
+    // Percentual usage of every category depends on the total time
+    if (d->totalSeconds != previousTotalSeconds) {
+        Q_EMIT dataChanged(index(0, 0), index(d->categories.count() - 1, 0));
+    }
+}
+
+void ActivityCategoryModel::sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    const qint64 previousTotalSeconds = d->totalSeconds;
+
+    for (int row = qMin(last, d->sourceRows.count() - 1); row >= first; row--) {
+        const Private::SourceRow sourceRow = d->sourceRows.at(row);
+        d->sourceRows.remove(row);
+
+        d->categories[sourceRow.category].seconds -= sourceRow.seconds;
+        d->categories[sourceRow.category].activityCount--;
+        d->totalSeconds -= sourceRow.seconds;
+
+        removeCategoryRowIfEmpty(sourceRow.category);
+    }
+
+    if (d->totalSeconds != previousTotalSeconds && !d->categories.isEmpty()) {
+        Q_EMIT dataChanged(index(0, 0), index(d->categories.count() - 1, 0));
+    }
+}
+
+void ActivityCategoryModel::sourceModelReset()
+{
+    beginResetModel();
+    d->sourceRows.clear();
+    d->categories.clear();
+    d->categoryRows.clear();
+    d->totalSeconds = 0;
+
+    const int count = d->sourceModel ? d->sourceModel->rowCount() : 0;
+    d->sourceRows.reserve(count);
+
+    for (int row = 0; row < count; row++) {
+        const QString categoryName = d->sourceCategory(row);
+        int category = d->categoryRows.value(categoryName, -1);
+        if (category < 0) {
+            category = d->categories.count();
+            Private::Category newCategory;
+            newCategory.name = categoryName;
+            newCategory.seconds = 0;
+            newCategory.activityCount = 0;
+            d->categories << newCategory;
+            d->categoryRows.insert(categoryName, category);
+        }
+
+        Private::SourceRow sourceRow;
+        sourceRow.category = category;
+        sourceRow.seconds = d->sourceSeconds(row);
+        d->sourceRows << sourceRow;
+
+        d->categories[category].seconds += sourceRow.seconds;
+        d->categories[category].activityCount++;
+        d->totalSeconds += sourceRow.seconds;
+    }
+    endResetModel();
+}
+
+int ActivityCategoryModel::categoryRow(const QString &category)
+{
+    auto it = d->categoryRows.constFind(category);
+    if (it != d->categoryRows.constEnd()) {
+        return *it;
+    }
+
+    const int row = d->categories.count();
+
+    Private::Category newCategory;
+    newCategory.name = category;
+    newCategory.seconds = 0;
+    newCategory.activityCount = 0;
+
+    beginInsertRows(QModelIndex(), row, row);
+    d->categories << newCategory;
+    d->categoryRows.insert(category, row);
+    endInsertRows();
+
+    return row;
+}
+
+void ActivityCategoryModel::removeCategoryRowIfEmpty(int row)
+{
+    if (d->categories.at(row).activityCount > 0) {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), row, row);
+    d->categoryRows.remove(d->categories.at(row).name);
+    d->categories.remove(row);
+    endRemoveRows();
+
+    // Categories don't disappear often, so it's fine to shift the indexes here
+    for (auto it = d->categoryRows.begin(); it != d->categoryRows.end(); ++it) {
+        if (*it > row) {
+            (*it)--;
+        }
+    }
+
+    for (auto it = d->sourceRows.begin(); it != d->sourceRows.end(); ++it) {
+        if (it->category > row) {
+            it->category--;
+        }
+    }
+}
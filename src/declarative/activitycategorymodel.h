@@ -0,0 +1,68 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_CATEGORY_MODEL_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_CATEGORY_MODEL_H
+
+#include <QAbstractListModel>
+
+#include "activitymodel.h"
+
+// Groups activities of the source model into categories defined by the
+// activity rules. Totals are kept up to date from the fine-grained signals
+// of the source model, so a change of one activity only touches its category.
+class Q_DECL_EXPORT ActivityCategoryModel : public QAbstractListModel
+{
+Q_OBJECT
+Q_PROPERTY(QAbstractItemModel * sourceModel READ sourceModel WRITE setSourceModel)
+public:
+    explicit ActivityCategoryModel(QObject *parent = 0);
+    virtual ~ActivityCategoryModel();
+
+    enum ItemRole {
+        CategoryNameRole = Qt::UserRole + 1,
+        CategoryTimeRole,
+        CategorySecondsRole,
+        CategoryPercentualUsageRole,
+        CategoryActivityCountRole
+    };
+
+    QAbstractItemModel *sourceModel() const;
+    void setSourceModel(QAbstractItemModel *sourceModel);
+
+    int rowCount(const QModelIndex &parent) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE;
+    virtual QHash< int, QByteArray > roleNames() const Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void sourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void sourceModelReset();
+
+private:
+    int categoryRow(const QString &category);
+    void removeCategoryRowIfEmpty(int row);
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_CATEGORY_MODEL_H
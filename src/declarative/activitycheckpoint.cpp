@@ -0,0 +1,250 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitycheckpoint.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLockFile>
+#include <QLoggingCategory>
+#include <QScopedPointer>
+#include <QStandardPaths>
+
+#include <cstring>
+
+Q_DECLARE_LOGGING_CATEGORY(PLASMA_TIMEKEEPER)
+
+static const quint32 CHECKPOINT_MAGIC = 0x504b4354; // "TCKP"
+static const quint32 CHECKPOINT_VERSION = 2;
+
+/*                     ActivityCheckpoint::Private                         *
+ * ----------------------------------------------------------------------- */
+class ActivityCheckpoint::Private
+{
+public:
+    // Times are milliseconds of the monotonic clock, which is only comparable
+    // within one boot, hence the boot id. The wall clock time of the last
+    // heartbeat places the recovered time in the history.
+    struct Record {
+        quint32 magic;
+        quint32 version;
+        char bootId[40];
+        qint64 intervalStart;
+        qint64 lastFlush;
+        qint64 lastSeen;
+        qint64 lastSeenUtc;
+        qint32 desktop;
+        quint32 kdeActivityLength;
+        char kdeActivity[64];
+        quint32 configGroupLength;
+        char configGroup[180];
+    };
+
+    Private()
+        : record(0)
+    {
+        recovered.seconds = 0;
+        recovered.desktop = 0;
+    }
+
+    static QByteArray currentBootId();
+    static qint64 now();
+
+    void seen();
+
+    // Only one instance tracks into the checkpoint, a second applet would overwrite
+    // the interval of the first one
+    QScopedPointer<QLockFile> lockFile;
+    QFile file;
+    Record *record;
+
+    Interval recovered;
+};
+
+QByteArray ActivityCheckpoint::Private::currentBootId()
+{
+    QFile bootIdFile(QStringLiteral("/proc/sys/kernel/random/boot_id"));
+    if (!bootIdFile.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    return bootIdFile.readAll().trimmed().left(sizeof(Record::bootId) - 1);
+}
+
+qint64 ActivityCheckpoint::Private::now()
+{
+    return QElapsedTimer::msecsSinceReference();
+}
+
+void ActivityCheckpoint::Private::seen()
+{
+    record->lastSeen = now();
+    record->lastSeenUtc = QDateTime::currentMSecsSinceEpoch();
+}
+
+/*                          ActivityCheckpoint                             *
+ * ----------------------------------------------------------------------- */
+
+ActivityCheckpoint::ActivityCheckpoint()
+    : d(new Private())
+{
+    const QString runtimeDir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (runtimeDir.isEmpty() || !QDir().mkpath(runtimeDir)) {
+        return;
+    }
+
+    const QString path = runtimeDir + QStringLiteral("/plasma-timekeeper-checkpoint");
+
+    // Held as long as the instance lives, locks of crashed instances are stale
+    d->lockFile.reset(new QLockFile(path + QStringLiteral(".lock")));
+    d->lockFile->setStaleLockTime(0);
+    if (!d->lockFile->tryLock(0)) {
+        qCDebug(PLASMA_TIMEKEEPER) << "Checkpoint is used by another instance";
+        return;
+    }
+
+    d->file.setFileName(path);
+    if (!d->file.open(QIODevice::ReadWrite)) {
+        return;
+    }
+
+    if (d->file.size() != qint64(sizeof(Private::Record)) && !d->file.resize(sizeof(Private::Record))) {
+        return;
+    }
+
+    d->record = reinterpret_cast<Private::Record *>(d->file.map(0, sizeof(Private::Record)));
+    if (!d->record) {
+        return;
+    }
+
+    const QByteArray bootId = Private::currentBootId();
+
+    // Recover the interval left behind by the previous instance
+    if (d->record->magic == CHECKPOINT_MAGIC && d->record->version == CHECKPOINT_VERSION &&
+        !bootId.isEmpty() && bootId == QByteArray(d->record->bootId) &&
+        d->record->configGroupLength > 0 && d->record->configGroupLength <= sizeof(Private::Record::configGroup) &&
+        d->record->lastSeen > d->record->lastFlush && d->record->lastSeen <= Private::now()) {
+        d->recovered.configGroup = QString::fromUtf8(d->record->configGroup, d->record->configGroupLength);
+        d->recovered.seconds = (d->record->lastSeen - d->record->lastFlush) / 1000;
+        d->recovered.end = QDateTime::fromMSecsSinceEpoch(d->record->lastSeenUtc, Qt::UTC);
+        d->recovered.desktop = d->record->desktop;
+        if (d->record->kdeActivityLength <= sizeof(Private::Record::kdeActivity)) {
+            d->recovered.kdeActivity = QString::fromUtf8(d->record->kdeActivity, d->record->kdeActivityLength);
+        }
+    }
+
+    memset(d->record, 0, sizeof(Private::Record));
+    d->record->magic = CHECKPOINT_MAGIC;
+    d->record->version = CHECKPOINT_VERSION;
+    memcpy(d->record->bootId, bootId.constData(), bootId.size());
+}
+
+ActivityCheckpoint::~ActivityCheckpoint()
+{
+    // The interval is deliberately left open, the next instance picks it up
+    heartbeat();
+
+    delete d;
+}
+
+bool ActivityCheckpoint::isValid() const
+{
+    return d->record;
+}
+
+bool ActivityCheckpoint::recover(Interval *interval) const
+{
+    if (d->recovered.configGroup.isEmpty() || d->recovered.seconds <= 0) {
+        return false;
+    }
+
+    *interval = d->recovered;
+
+    return true;
+}
+
+void ActivityCheckpoint::startInterval(const QString &configGroup, qint64 unflushedMsecs)
+{
+    if (!d->record) {
+        return;
+    }
+
+    QByteArray utf8 = configGroup.toUtf8();
+    if (utf8.size() > int(sizeof(Private::Record::configGroup))) {
+        // Can't be recovered without the full name
+        utf8.clear();
+    }
+
+    const qint64 now = Private::now();
+
+    // Invalidate the interval first, so a crash in between doesn't mix two of them
+    d->record->configGroupLength = 0;
+    d->record->intervalStart = now;
+    d->record->lastFlush = now - qMax<qint64>(unflushedMsecs, 0);
+    d->seen();
+    memcpy(d->record->configGroup, utf8.constData(), utf8.size());
+    d->record->configGroupLength = utf8.size();
+}
+
+void ActivityCheckpoint::stopInterval()
+{
+    if (!d->record) {
+        return;
+    }
+
+    d->record->configGroupLength = 0;
+}
+
+void ActivityCheckpoint::setPartition(int desktop, const QString &kdeActivity)
+{
+    if (!d->record) {
+        return;
+    }
+
+    QByteArray utf8 = kdeActivity.toUtf8();
+    if (utf8.size() > int(sizeof(Private::Record::kdeActivity))) {
+        utf8.clear();
+    }
+
+    d->record->desktop = desktop;
+    d->record->kdeActivityLength = 0;
+    memcpy(d->record->kdeActivity, utf8.constData(), utf8.size());
+    d->record->kdeActivityLength = utf8.size();
+}
+
+void ActivityCheckpoint::flushed()
+{
+    if (!d->record) {
+        return;
+    }
+
+    d->seen();
+    d->record->lastFlush = d->record->lastSeen;
+}
+
+void ActivityCheckpoint::heartbeat()
+{
+    if (!d->record || !d->record->configGroupLength) {
+        return;
+    }
+
+    d->seen();
+}
@@ -0,0 +1,77 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_CHECKPOINT_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_CHECKPOINT_H
+
+#include <QDateTime>
+#include <QString>
+
+/*                          ActivityCheckpoint                             *
+ * ----------------------------------------------------------------------- */
+
+// Small fixed-size record of the activity being tracked, kept in a memory-mapped
+// file in the runtime directory. Updating it is just a few stores into the mapped
+// page, so it can be done far more often than writing the config. When plasmashell
+// dies, the time between the last config write and the last heartbeat can be
+// recovered on the next start, as long as the system wasn't rebooted meanwhile.
+// Only the first of several instances gets a checkpoint, the others aren't valid.
+class ActivityCheckpoint
+{
+public:
+    // Time tracked but never written by the previous instance
+    struct Interval {
+        QString configGroup;
+        int seconds;
+        // When the previous instance was seen alive for the last time
+        QDateTime end;
+        int desktop;
+        QString kdeActivity;
+    };
+
+    ActivityCheckpoint();
+    ~ActivityCheckpoint();
+
+    bool isValid() const;
+
+    // Only valid right after construction
+    bool recover(Interval *interval) const;
+
+    // The interval has been written to the config up to unflushedMsecs ago
+    void startInterval(const QString &configGroup, qint64 unflushedMsecs);
+    void stopInterval();
+
+    // Virtual desktop and KDE activity the time is counted for
+    void setPartition(int desktop, const QString &kdeActivity);
+
+    // The interval has been written to the config up to now
+    void flushed();
+
+    // The interval is still going on
+    void heartbeat();
+
+private:
+    Q_DISABLE_COPY(ActivityCheckpoint)
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_CHECKPOINT_H
@@ -0,0 +1,269 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitylimits.h"
+#include "timekeeperclock.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+#include <QtDebug>
+
+#include <limits>
+
+/*                       ActivityLimits::Private                           *
+ * ----------------------------------------------------------------------- */
+class ActivityLimits::Private
+{
+public:
+    struct Limit {
+        QString target;
+        int seconds;
+    };
+
+    static QString categoryKey(const QString &category)
+    {
+        return QLatin1Char('@') + category;
+    }
+
+    QVector<int> currentLimits() const;
+    qint64 pendingMsecs() const;
+    void checkDay();
+    void skipReachedLimits();
+
+    QStringList limitLines;
+
+    // Limits indexed by activity name or "@category"
+    QVector<Limit> limits;
+    QMultiHash<QString, int> limitsByTarget;
+
+    // Usage of today, indexed the same way as the limits
+    QHash<QString, qint64> usage;
+    QSet<int> reachedLimits;
+    QDate day;
+
+    // Time of the current activity not yet reported by addUsage(), measured with
+    // the clock of the model so it restarts at midnight like the usage does
+    QString currentName;
+    QString currentCategory;
+    QDateTime currentSince;
+
+    QTimer timer;
+};
+
+QVector<int> ActivityLimits::Private::currentLimits() const
+{
+    QVector<int> result;
+
+    if (currentName.isEmpty()) {
+        return result;
+    }
+
+    result += limitsByTarget.values(currentName).toVector();
+    if (!currentCategory.isEmpty()) {
+        result += limitsByTarget.values(categoryKey(currentCategory)).toVector();
+    }
+
+    return result;
+}
+
+qint64 ActivityLimits::Private::pendingMsecs() const
+{
+    if (currentName.isEmpty()) {
+        return 0;
+    }
+
+    return qMax<qint64>(currentSince.msecsTo(TimekeeperClock::currentDateTime()), 0);
+}
+
+void ActivityLimits::Private::checkDay()
+{
+    const QDate today = TimekeeperClock::currentDate();
+    if (day == today) {
+        return;
+    }
+
+    day = today;
+    usage.clear();
+    reachedLimits.clear();
+
+    // Whatever ran before midnight counts for the previous day
+    const QDateTime midnight(today, QTime(0, 0));
+    if (currentSince < midnight) {
+        currentSince = midnight;
+    }
+}
+
+void ActivityLimits::Private::skipReachedLimits()
+{
+    // Limits already crossed today don't fire again
+    for (int i = 0; i < limits.count(); i++) {
+        if (usage.value(limits.at(i).target) >= limits.at(i).seconds) {
+            reachedLimits.insert(i);
+        }
+    }
+}
+
+/*                          ActivityLimits                                 *
+ * ----------------------------------------------------------------------- */
+
+ActivityLimits::ActivityLimits(QObject *parent)
+    : QObject(parent),
+      d(new Private())
+{
+    d->day = TimekeeperClock::currentDate();
+    d->timer.setSingleShot(true);
+    d->timer.setTimerType(Qt::PreciseTimer);
+    connect(&d->timer, &QTimer::timeout, this, &ActivityLimits::deadlineReached);
+}
+
+ActivityLimits::~ActivityLimits()
+{
+    delete d;
+}
+
+void ActivityLimits::setLimits(const QStringList &limits)
+{
+    if (d->limitLines == limits) {
+        return;
+    }
+
+    d->limitLines = limits;
+    d->limits.clear();
+    d->limitsByTarget.clear();
+    d->reachedLimits.clear();
+
+    foreach (const QString &line, limits) {
+        if (line.trimmed().isEmpty() || line.trimmed().startsWith(QLatin1Char('#'))) {
+            continue;
+        }
+
+        const int separator = line.lastIndexOf(QLatin1Char('='));
+        bool ok = false;
+        const int minutes = separator > 0 ? line.mid(separator + 1).trimmed().toInt(&ok) : 0;
+        const QString target = line.left(separator).trimmed();
+
+        if (!ok || minutes <= 0 || target.isEmpty()) {
+            qWarning() << "Ignoring malformed usage limit" << line;
+            continue;
+        }
+
+        Private::Limit limit;
+        limit.target = target;
+        limit.seconds = minutes * 60;
+        d->limitsByTarget.insert(target, d->limits.count());
+        d->limits << limit;
+    }
+
+    d->skipReachedLimits();
+
+    rearm();
+}
+
+QStringList ActivityLimits::limits() const
+{
+    return d->limitLines;
+}
+
+void ActivityLimits::addUsage(const QString &name, const QString &category, int secs)
+{
+    d->checkDay();
+
+    d->usage[name] += secs;
+    if (!category.isEmpty()) {
+        d->usage[Private::categoryKey(category)] += secs;
+    }
+
+    if (name == d->currentName) {
+        d->currentSince = TimekeeperClock::currentDateTime();
+    }
+
+    rearm();
+}
+
+void ActivityLimits::setUsage(const QHash<QString, qint64> &activities, const QHash<QString, qint64> &categories)
+{
+    d->checkDay();
+
+    // Time of the current activity since the last addUsage() is in neither of them
+    d->usage = activities;
+    for (auto it = categories.constBegin(); it != categories.constEnd(); ++it) {
+        d->usage.insert(Private::categoryKey(it.key()), it.value());
+    }
+
+    d->skipReachedLimits();
+
+    rearm();
+}
+
+void ActivityLimits::setCurrentActivity(const QString &name, const QString &category)
+{
+    d->currentName = name;
+    d->currentCategory = category;
+    d->currentSince = TimekeeperClock::currentDateTime();
+
+    rearm();
+}
+
+void ActivityLimits::deadlineReached()
+{
+    d->checkDay();
+
+    const qint64 pendingSecs = d->pendingMsecs() / 1000;
+
+    foreach (int index, d->currentLimits()) {
+        const Private::Limit &limit = d->limits.at(index);
+        if (!d->reachedLimits.contains(index) && d->usage.value(limit.target) + pendingSecs >= limit.seconds) {
+            d->reachedLimits.insert(index);
+            Q_EMIT limitReached(limit.target, limit.seconds / 60);
+        }
+    }
+
+    rearm();
+}
+
+void ActivityLimits::rearm()
+{
+    d->timer.stop();
+
+    if (d->currentName.isEmpty() || d->limits.isEmpty()) {
+        return;
+    }
+
+    const qint64 pendingMsecs = d->pendingMsecs();
+
+    // Usage is counted per day, so wake up at midnight at the latest
+    const QDateTime now = TimekeeperClock::currentDateTime();
+    qint64 deadline = now.msecsTo(QDateTime(now.date().addDays(1), QTime(0, 0)));
+
+    foreach (int index, d->currentLimits()) {
+        if (d->reachedLimits.contains(index)) {
+            continue;
+        }
+
+        const Private::Limit &limit = d->limits.at(index);
+        const qint64 remaining = limit.seconds * 1000 - d->usage.value(limit.target) * 1000 - pendingMsecs;
+        deadline = qMin(deadline, qMax<qint64>(remaining, 0));
+    }
+
+    d->timer.start(int(qMin<qint64>(deadline, std::numeric_limits<int>::max())));
+}
@@ -0,0 +1,68 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_LIMITS_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_LIMITS_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+
+/*                          ActivityLimits                                 *
+ * ----------------------------------------------------------------------- */
+
+// Daily usage limits of activities or categories, one per line in the form
+// "<activity> = <minutes>" or "@<category> = <minutes>". Instead of checking
+// the limits periodically, the exact moment the current activity crosses its
+// next limit is computed whenever it changes and a single timer is armed for it.
+class ActivityLimits : public QObject
+{
+Q_OBJECT
+public:
+    explicit ActivityLimits(QObject *parent = 0);
+    virtual ~ActivityLimits();
+
+    void setLimits(const QStringList &limits);
+    QStringList limits() const;
+
+    // Time tracked for the given activity
+    void addUsage(const QString &name, const QString &category, int secs);
+
+    // Replaces the usage of today, e.g. with the one found in the history after
+    // a restart. Limits already crossed by it don't fire anymore.
+    void setUsage(const QHash<QString, qint64> &activities, const QHash<QString, qint64> &categories);
+
+    // Activity being tracked from now on, empty name if there is none
+    void setCurrentActivity(const QString &name, const QString &category);
+
+Q_SIGNALS:
+    void limitReached(const QString &name, int minutes);
+
+private Q_SLOTS:
+    void deadlineReached();
+
+private:
+    void rearm();
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_LIMITS_H
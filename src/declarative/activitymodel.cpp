@@ -19,6 +19,14 @@
 */
 
 #include "activitymodel.h"
+#include "activitycheckpoint.h"
+#include "activityhistory.h"
+#include "activitylimits.h"
+#include "activityrules.h"
+#include "durationformat.h"
+#include "focusbackend.h"
+#include "timekeeperclock.h"
+#include "timekeeperstatistics.h"
 
 #include <KConfig>
 #include <KConfigGroup>
@@ -27,13 +35,18 @@
 
 #include <KWindowSystem>
 
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QLoggingCategory>
+#include <QStandardPaths>
 #include <QDBusConnection>
 #include <QDBusInterface>
 #include <QDBusPendingCall>
 #include <QDBusPendingReply>
 #include <QDBusUnixFileDescriptor>
 
+#include <algorithm>
+
 Q_DECLARE_LOGGING_CATEGORY(PLASMA_TIMEKEEPER)
 
 Q_LOGGING_CATEGORY(PLASMA_TIMEKEEPER, "plasma-timekeeper")
@@ -44,20 +57,105 @@ const static QString LOGIN1_DBUS_MANAGER_INTERFACE = QStringLiteral("org.freedes
 
 const static QString OTHER_APPLICATIONS_NAME = i18n("other applications");
 
+const static QString ACTIVITY_MANAGER_DBUS_SERVICE = QStringLiteral("org.kde.ActivityManager");
+const static QString ACTIVITY_MANAGER_DBUS_PATH = QStringLiteral("/ActivityManager/Activities");
+const static QString ACTIVITY_MANAGER_DBUS_INTERFACE = QStringLiteral("org.kde.ActivityManager.Activities");
+
+// Config entries with the time of one partition are named "partition_<desktop>_<KDE activity>"
+// Where dumpStatistics() can be called, e.g. with qdbus org.kde.plasmashell /PlasmaTimekeeper/Statistics
+const static QString STATISTICS_DBUS_PATH = QStringLiteral("/PlasmaTimekeeper/Statistics");
+
+const static QString PARTITION_ENTRY_PREFIX = QStringLiteral("partition_");
+
+// History intervals held back by windows waiting for their class or by another
+// writer of the history, beyond this the time of those windows is dropped first
+// and then the oldest intervals
+const static int MAX_QUEUED_HISTORY = 1000;
+
+// Queued history intervals are written in one batch this often
+const static int HISTORY_WRITE_INTERVAL = 60000;
+
+// Milliseconds flushing before suspend or shutdown should take at most. The flush
+// is a single synchronous config write which can't be cut short, taking longer
+// only gets reported.
+const static int FLUSH_DEADLINE = 500;
+
+// A partition id packs the desktop into the low and the interned KDE activity into
+// the high 16 bits, a counter key the partition id and the item id
+static inline quint32 partitionId(int desktop, quint16 kdeActivity)
+{
+    return (quint32(kdeActivity) << 16) | quint16(desktop);
+}
+
+static inline quint64 counterKey(quint32 partition, quint32 item)
+{
+    return (quint64(partition) << 32) | item;
+}
+
+static void syncConfig(const KSharedConfigPtr &config)
+{
+    // Only flushes that actually write something are interesting
+    if (!config->isDirty()) {
+        return;
+    }
+
+    TIMEKEEPER_STATISTICS_SCOPE(ConfigFlushProbe);
+
+    config->sync();
+
+#ifdef TIMEKEEPER_STATISTICS
+    // The file doesn't move, so it's only looked up once
+    static QString path;
+    if (path.isEmpty()) {
+        path = QStandardPaths::locate(QStandardPaths::GenericConfigLocation, config->name());
+    }
+    TIMEKEEPER_STATISTICS_ADD(ConfigFlushBytesCounter, QFileInfo(path).size());
+#endif
+}
+
+// Times are kept as times of day, an interval crossing midnight wraps around
+static inline int secondsBetween(const QTime &from, const QTime &to)
+{
+    int secs = from.secsTo(to);
+    if (secs < -12 * 3600) {
+        secs += 24 * 3600;
+    }
+    return qMax(secs, 0);
+}
+
+// Recent times of day are turned into absolute ones for the history
+static inline QDateTime toDateTime(const QTime &time)
+{
+    qint64 msecs = TimekeeperClock::currentTime().msecsTo(time);
+    if (msecs > 12 * 3600 * 1000) {
+        msecs -= 24 * 3600 * 1000;
+    }
+    return TimekeeperClock::currentDateTimeUtc().addMSecs(msecs);
+}
+
+static inline qint64 pixmapBytes(const QPixmap &pixmap)
+{
+    return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
 /*                     ActivityModelItem::Private                          *
  * ----------------------------------------------------------------------- */
 class ActivityModelItem::Private
 {
 public:
     Private()
-        : percentualUsage(0)
+        : id(0),
+          percentualUsage(0)
     { }
 
     QPixmap activityIcon;
-    QPixmap activityDefaultIcon;
     QString activityName;
     QTime activityTime;
+    QString category;
     QString configGroup;
+    QString windowClass;
+    QDate lastUsed;
+    quint32 id;
     int percentualUsage;
 };
 
@@ -85,16 +183,6 @@ QPixmap ActivityModelItem::activityIcon() const
     return d->activityIcon;
 }
 
-void ActivityModelItem::setActivityDefaultIcon(const QPixmap &icon)
-{
-    d->activityDefaultIcon = icon;
-}
-
-QPixmap ActivityModelItem::activityDefaultIcon() const
-{
-    return d->activityDefaultIcon;
-}
-
 void ActivityModelItem::setActivityName(const QString &name)
 {
     d->activityName = name;
@@ -115,6 +203,16 @@ QTime ActivityModelItem::activityTime() const
     return d->activityTime;
 }
 
+void ActivityModelItem::setCategory(const QString &category)
+{
+    d->category = category;
+}
+
+QString ActivityModelItem::category() const
+{
+    return d->category;
+}
+
 void ActivityModelItem::setConfigGroup(const QString &group)
 {
     d->configGroup = group;
@@ -125,6 +223,36 @@ QString ActivityModelItem::configGroup() const
     return d->configGroup;
 }
 
+void ActivityModelItem::setWindowClass(const QString &windowClass)
+{
+    d->windowClass = windowClass;
+}
+
+QString ActivityModelItem::windowClass() const
+{
+    return d->windowClass;
+}
+
+void ActivityModelItem::setLastUsed(const QDate &date)
+{
+    d->lastUsed = date;
+}
+
+QDate ActivityModelItem::lastUsed() const
+{
+    return d->lastUsed;
+}
+
+void ActivityModelItem::setId(quint32 id)
+{
+    d->id = id;
+}
+
+quint32 ActivityModelItem::id() const
+{
+    return d->id;
+}
+
 void ActivityModelItem::setPercentualUsage(int percentualUsage)
 {
     d->percentualUsage = percentualUsage;
@@ -151,13 +279,42 @@ public:
       resetOnSuspend(false),
       resetOnShutdown(false),
       screenLocked(false),
-      timeTrackingEnabled(true)
+      timeTrackingEnabled(true),
+      configSyncDeferred(false),
+      lastFlushLatency(-1),
+      archiveAfterDays(0),
+      maximumIconCount(32),
+      activeWindow(0),
+      activeWindowPending(false),
+      focusBackend(0),
+      limits(0),
+      currentItem(0),
+      nextItemId(0),
+      totalSeconds(0),
+      iconMemory(0),
+      currentDesktop(0),
+      currentPartition(0),
+      switchedSeconds(0),
+      currentTimeTextSeconds(-1),
+      totalTimeTextSeconds(-1)
     { }
 
     ~Private()
     {
     }
 
+    bool trackingActive() const;
+    QDateTime pendingSince() const;
+    void setIcon(ActivityModelItem *item, const QPixmap &icon);
+    quint16 kdeActivityId(const QString &kdeActivity);
+    int findKdeActivity(const QString &kdeActivity) const;
+    bool partitionMatches(quint32 partition, int desktop, int kdeActivity) const;
+    QString partitionEntry(quint32 partition) const;
+    void addPartitionSeconds(quint32 partition, quint32 item, qint64 seconds);
+    void loadPartitions(ActivityModelItem *item, const KConfigGroup &group);
+    void writePartitions(const ActivityModelItem *item, KConfigGroup &group) const;
+    void forgetPartitions(const ActivityModelItem *item);
+
     bool preparingForSleep;
     bool preparingForShutdown;
     bool resetOnSuspend;
@@ -165,26 +322,233 @@ public:
     bool screenLocked;
     bool timeTrackingEnabled;
 
+    // Set while flushing before suspend or shutdown, which syncs the config only once
+    bool configSyncDeferred;
+
+    // Milliseconds flushing before suspend or shutdown took the last time
+    int lastFlushLatency;
+
+    int archiveAfterDays;
+    int maximumIconCount;
+
     // Current activity and time when the activity was updated for the last time
     QString currentActiveWindow;
     QTime currentTime;
 
+    // Focused window and the time it got focus, it might be still waiting for its class
+    WId activeWindow;
+    QTime activeWindowTime;
+    bool activeWindowPending;
+
+    // Time spent in windows before their class was known, it is credited to
+    // their activities once they get resolved
+    struct PendingInterval {
+        QDateTime end;
+        int seconds;
+        quint32 partition;
+    };
+    QHash<WId, QVector<PendingInterval> > pendingIntervals;
+
+    // Intervals for the history sorted by start. The history is sorted as
+    // well, so they are held back while a window which got focus earlier is
+    // still waiting for its class. Written by the history timer, so focus
+    // changes never wait for the lock of the history.
+    struct HistoryRecord {
+        QString name;
+        QDateTime start;
+        int seconds;
+    };
+    QVector<HistoryRecord> historyQueue;
+
+    // Active window and its application, X11 or Wayland
+    FocusBackend *focusBackend;
+
+    // Daily usage limits
+    ActivityLimits *limits;
+
     // List of activities
     QList<ActivityModelItem*> list;
 
-    // List of ignored activities
-    QStringList ignoredActivitiesList;
+    // Items holding an icon, most recently used first, and the icon shown for the others
+    QList<ActivityModelItem*> iconCache;
+    QPixmap defaultIcon;
+    qint64 iconMemory;
+
+    // Item of the current activity and sum of time of all items
+    ActivityModelItem *currentItem;
+    quint32 nextItemId;
+    qint64 totalSeconds;
+
+    // Current partition, switching it only changes where time is counted from now on
+    int currentDesktop;
+    QString currentKdeActivity;
+    quint32 currentPartition;
+
+    // Time of the current item since the last tick already counted for the
+    // partitions left meanwhile, the tick only counts the rest for the current one
+    int switchedSeconds;
+    QVector<quint32> switchedPartitions;
+
+    // KDE activities are interned, their index is used in partition ids
+    QStringList kdeActivities;
+    QHash<QString, quint16> kdeActivityIds;
+
+    // Time per partition and item and per partition, all time of an item is
+    // still kept by the item itself
+    QVector<quint32> partitions;
+    QHash<quint64, qint64> partitionSeconds;
+    QHash<quint32, qint64> partitionTotals;
+
+    // Formatted times are cached and only recomputed when the shown value changes
+    QString currentTimeText;
+    qint64 currentTimeTextSeconds;
+    QString totalTimeText;
+    qint64 totalTimeTextSeconds;
+
+    // Activities ignored by earlier versions, they are turned into ignore rules
+    QStringList legacyIgnoredActivities;
+
+    // Ignore, rename and category rules
+    ActivityRules rules;
 
     // Timer
     QTimer timer;
 
+    // Unloads activities not used for a long time
+    QTimer archiveTimer;
+
+    // Keeps the checkpoint of the current interval alive
+    QTimer heartbeatTimer;
+    ActivityCheckpoint checkpoint;
+
+    // Interval history for timekeeper-query, not cleared on reset
+    ActivityHistory history;
+    QTimer historyTimer;
+
     QDBusUnixFileDescriptor inhibitFileDescriptor;
 };
 
+bool ActivityModel::Private::trackingActive() const
+{
+    return timeTrackingEnabled && !screenLocked && !preparingForSleep && !preparingForShutdown;
+}
+
+QDateTime ActivityModel::Private::pendingSince() const
+{
+    QDateTime since;
+
+    if (activeWindowPending) {
+        since = toDateTime(activeWindowTime);
+    }
+
+    foreach (const QVector<PendingInterval> &intervals, pendingIntervals) {
+        foreach (const PendingInterval &interval, intervals) {
+            const QDateTime start = interval.end.addSecs(-interval.seconds);
+            if (!since.isValid() || start < since) {
+                since = start;
+            }
+        }
+    }
+
+    return since;
+}
+
+void ActivityModel::Private::setIcon(ActivityModelItem *item, const QPixmap &icon)
+{
+    iconMemory += pixmapBytes(icon) - pixmapBytes(item->activityIcon());
+    item->setActivityIcon(icon);
+}
+
+quint16 ActivityModel::Private::kdeActivityId(const QString &kdeActivity)
+{
+    auto it = kdeActivityIds.constFind(kdeActivity);
+    if (it == kdeActivityIds.constEnd()) {
+        it = kdeActivityIds.insert(kdeActivity, kdeActivities.count());
+        kdeActivities << kdeActivity;
+    }
+
+    return *it;
+}
+
+int ActivityModel::Private::findKdeActivity(const QString &kdeActivity) const
+{
+    // -1 matches any KDE activity, -2 none
+    if (kdeActivity.isEmpty()) {
+        return -1;
+    }
+
+    auto it = kdeActivityIds.constFind(kdeActivity);
+    return it != kdeActivityIds.constEnd() ? int(*it) : -2;
+}
+
+bool ActivityModel::Private::partitionMatches(quint32 partition, int desktop, int kdeActivity) const
+{
+    return (desktop <= 0 || int(partition & 0xffff) == desktop) && (kdeActivity == -1 || int(partition >> 16) == kdeActivity);
+}
+
+QString ActivityModel::Private::partitionEntry(quint32 partition) const
+{
+    return PARTITION_ENTRY_PREFIX + QString::number(partition & 0xffff) + QLatin1Char('_') + kdeActivities.at(partition >> 16);
+}
+
+void ActivityModel::Private::addPartitionSeconds(quint32 partition, quint32 item, qint64 seconds)
+{
+    if (!partitions.contains(partition)) {
+        partitions << partition;
+    }
+
+    partitionSeconds[counterKey(partition, item)] += seconds;
+    partitionTotals[partition] += seconds;
+}
+
+void ActivityModel::Private::loadPartitions(ActivityModelItem *item, const KConfigGroup &group)
+{
+    foreach (const QString &key, group.keyList()) {
+        if (!key.startsWith(PARTITION_ENTRY_PREFIX)) {
+            continue;
+        }
+
+        const int separator = key.indexOf(QLatin1Char('_'), PARTITION_ENTRY_PREFIX.length());
+        if (separator < 0) {
+            continue;
+        }
+
+        const int desktop = key.mid(PARTITION_ENTRY_PREFIX.length(), separator - PARTITION_ENTRY_PREFIX.length()).toInt();
+        const QString kdeActivity = key.mid(separator + 1);
+        addPartitionSeconds(partitionId(desktop, kdeActivityId(kdeActivity)), item->id(), group.readEntry(key, qint64(0)));
+    }
+}
+
+void ActivityModel::Private::writePartitions(const ActivityModelItem *item, KConfigGroup &group) const
+{
+    foreach (quint32 partition, partitions) {
+        const qint64 seconds = partitionSeconds.value(counterKey(partition, item->id()));
+        if (seconds) {
+            group.writeEntry(partitionEntry(partition), seconds);
+        }
+    }
+}
+
+void ActivityModel::Private::forgetPartitions(const ActivityModelItem *item)
+{
+    foreach (quint32 partition, partitions) {
+        auto it = partitionSeconds.find(counterKey(partition, item->id()));
+        if (it != partitionSeconds.end()) {
+            partitionTotals[partition] -= *it;
+            partitionSeconds.erase(it);
+        }
+    }
+}
+
 /*                          ActivityModel                                  *
  * ----------------------------------------------------------------------- */
 
 ActivityModel::ActivityModel(QObject *parent)
+    : ActivityModel(FocusBackend::create(), parent)
+{
+}
+
+ActivityModel::ActivityModel(FocusBackend *focusBackend, QObject *parent)
     : QAbstractListModel(parent),
       d(new Private())
 {
@@ -206,9 +570,57 @@ ActivityModel::ActivityModel(QObject *parent)
         }
     });
 
-    connect(KWindowSystem::self(), &KWindowSystem::activeWindowChanged, this, &ActivityModel::activeWindowChanged, Qt::UniqueConnection);
+    d->limits = new ActivityLimits(this);
+    connect(d->limits, &ActivityLimits::limitReached, this, &ActivityModel::limitReached);
+
+    d->focusBackend = focusBackend;
+    d->focusBackend->setParent(this);
+    connect(d->focusBackend, &FocusBackend::windowResolved, this, &ActivityModel::windowResolved);
+    connect(d->focusBackend, &FocusBackend::iconResolved, this, &ActivityModel::iconResolved);
+    connect(d->focusBackend, &FocusBackend::activeWindowChanged, this, &ActivityModel::activeWindowChanged, Qt::UniqueConnection);
     connect(&d->timer, &QTimer::timeout, this, &ActivityModel::updateCurrentActivityTime);
 
+    d->archiveTimer.setTimerType(Qt::VeryCoarseTimer);
+    d->archiveTimer.start(3600000);
+    connect(&d->archiveTimer, &QTimer::timeout, this, &ActivityModel::archiveUnusedActivities);
+
+    // Apart from the tick, which starts over with every focus change
+    d->history.setLockTimeout(0);
+    d->historyTimer.setTimerType(Qt::VeryCoarseTimer);
+    d->historyTimer.start(HISTORY_WRITE_INTERVAL);
+    connect(&d->historyTimer, &QTimer::timeout, this, &ActivityModel::writeHistory);
+
+    d->heartbeatTimer.setTimerType(Qt::VeryCoarseTimer);
+    d->heartbeatTimer.setInterval(15000);
+    connect(&d->heartbeatTimer, &QTimer::timeout, this, [this] () {
+        d->checkpoint.heartbeat();
+    });
+
+    connect(KWindowSystem::self(), &KWindowSystem::currentDesktopChanged, this, &ActivityModel::currentDesktopChanged);
+    d->currentDesktop = KWindowSystem::currentDesktop();
+    d->currentPartition = partitionId(d->currentDesktop, d->kdeActivityId(d->currentKdeActivity));
+    d->checkpoint.setPartition(d->currentDesktop, d->currentKdeActivity);
+
+    QDBusConnection::sessionBus().connect(ACTIVITY_MANAGER_DBUS_SERVICE,
+                                          ACTIVITY_MANAGER_DBUS_PATH,
+                                          ACTIVITY_MANAGER_DBUS_INTERFACE,
+                                          QStringLiteral("CurrentActivityChanged"),
+                                          this,
+                                          SLOT(currentKdeActivityChanged(QString)));
+
+    QDBusInterface activityManager(ACTIVITY_MANAGER_DBUS_SERVICE,
+                                   ACTIVITY_MANAGER_DBUS_PATH,
+                                   ACTIVITY_MANAGER_DBUS_INTERFACE,
+                                   QDBusConnection::sessionBus());
+    QDBusPendingCallWatcher *activityWatcher = new QDBusPendingCallWatcher(activityManager.asyncCall(QStringLiteral("CurrentActivity")), this);
+    connect(activityWatcher, &QDBusPendingCallWatcher::finished, this, [this] (QDBusPendingCallWatcher *watcher) {
+        QDBusPendingReply<QString> reply = *watcher;
+        watcher->deleteLater();
+        if (reply.isValid()) {
+            currentKdeActivityChanged(reply.value());
+        }
+    });
+
     // TODO check if logind is running
 
     QDBusConnection::sessionBus().connect(QStringLiteral("org.kde.ksmserver"),
@@ -233,22 +645,73 @@ ActivityModel::ActivityModel(QObject *parent)
                                          SLOT(prepareForShutdownChanged(bool)));
     inhibit();
 
-    // Load previous values
+#ifdef TIMEKEEPER_STATISTICS
+    // Every change announced to the views, whichever code path caused it
+    auto countSignal = [] () {
+        TIMEKEEPER_STATISTICS_ADD(ModelSignalCounter, 1);
+    };
+    connect(this, &QAbstractItemModel::dataChanged, this, countSignal);
+    connect(this, &QAbstractItemModel::rowsInserted, this, countSignal);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, countSignal);
+    connect(this, &QAbstractItemModel::modelReset, this, countSignal);
+    connect(this, &ActivityModel::currentActivityNameChanged, this, countSignal);
+    connect(this, &ActivityModel::currentActivityIconChanged, this, countSignal);
+    connect(this, &ActivityModel::currentActivityTimeChanged, this, countSignal);
+    connect(this, &ActivityModel::totalActivityTimeChanged, this, countSignal);
+
+    // The statistics are shared by all instances in the process, the first one exposes them
+    if (!QDBusConnection::sessionBus().registerObject(STATISTICS_DBUS_PATH, this, QDBusConnection::ExportScriptableSlots)) {
+        qCDebug(PLASMA_TIMEKEEPER) << "Statistics are already exposed on the session bus";
+    }
+#endif
+
+    d->defaultIcon = QIcon::fromTheme(QStringLiteral("plasma")).pixmap(QSize(64, 64));
+
+    // Load previous values, activities unused for long get archived once the
+    // configuration is applied
     KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+
+    // The last suspend or shutdown should have reset the statistics, but we didn't get to it
+    KConfigGroup generalGroup(config, QStringLiteral("general"));
+    if (generalGroup.readEntry(QStringLiteral("resetPending"), false)) {
+        foreach (const QString &groupName, config->groupList()) {
+            if (groupName != QStringLiteral("general")) {
+                config->deleteGroup(groupName);
+            }
+        }
+        generalGroup.deleteEntry(QStringLiteral("resetPending"));
+        syncConfig(config);
+    }
+
     foreach (const QString &groupName, config->groupList()) {
         KConfigGroup group(config, groupName);
         if (group.isValid()) {
             if (groupName == QStringLiteral("general")) {
                 d->timeTrackingEnabled = group.readEntry<bool>("trackingEnabled", true);
-                d->ignoredActivitiesList = group.readEntry<QStringList>("ignoredActivities", QStringList());
+                d->legacyIgnoredActivities = group.readEntry<QStringList>("ignoredActivities", QStringList());
+                QStringList legacyRules;
+                foreach (const QString &activity, d->legacyIgnoredActivities) {
+                    legacyRules << ActivityRules::ignoreRule(activity);
+                }
+                d->rules.setRules(legacyRules);
                 continue;
             }
 
             ActivityModelItem *item = new ActivityModelItem(this);
             item->setActivityName(group.readEntry(QStringLiteral("name")));
-            item->setActivityDefaultIcon(QIcon::fromTheme(QStringLiteral("plasma")).pixmap(QSize(64, 64)));
             item->setActivityTime(QTime::fromString(group.readEntry(QStringLiteral("time"), groupName)));
             item->setConfigGroup(groupName);
+            item->setWindowClass(group.readEntry(QStringLiteral("windowClass")));
+            item->setId(d->nextItemId++);
+            d->loadPartitions(item, group);
+            item->setLastUsed(QDate::fromString(group.readEntry(QStringLiteral("lastUsed")), Qt::ISODate));
+
+            // Activities stored before usage dates were recorded start aging now
+            if (!item->lastUsed().isValid()) {
+                item->setLastUsed(TimekeeperClock::currentDate());
+                group.writeEntry(QStringLiteral("lastUsed"), item->lastUsed().toString(Qt::ISODate));
+            }
+            d->totalSeconds += QTime(0, 0).secsTo(item->activityTime());
 
             const int index = d->list.count();
             beginInsertRows(QModelIndex(), index, index);
@@ -257,12 +720,24 @@ ActivityModel::ActivityModel(QObject *parent)
         }
     }
 
+    // Recovered time is not in the history yet and gets added on top
+    restoreLimitUsage();
+    recoverCheckpoint();
+    updateFormattedTimes();
+
     // Process the currently active window
-    activeWindowChanged(KWindowSystem::activeWindow());
+    activeWindowChanged(d->focusBackend->activeWindow());
 }
 
 ActivityModel::~ActivityModel()
 {
+    // Windows still waiting for their class won't get it anymore, the rest of
+    // the queue is worth waiting a moment for another writer
+    d->pendingIntervals.clear();
+    d->activeWindowPending = false;
+    d->history.setLockTimeout(1000);
+    writeHistory();
+
     delete d;
 }
 
@@ -275,7 +750,7 @@ QVariant ActivityModel::data(const QModelIndex &index, int role) const
 
         switch (role) {
             case ActivityIconRole:
-                return item->activityIcon().isNull() ? item->activityDefaultIcon() : item->activityIcon();
+                return item->activityIcon().isNull() ? d->defaultIcon : item->activityIcon();
                 break;
             case ActivityNameRole:
                 return item->activityName();
@@ -286,6 +761,12 @@ QVariant ActivityModel::data(const QModelIndex &index, int role) const
             case ActivityPercentualUsage:
                 return item->percentualUsage();
                 break;
+            case ActivityCategoryRole:
+                return item->category();
+                break;
+            case ActivitySecondsRole:
+                return QTime(0, 0).secsTo(item->activityTime());
+                break;
             default:
                 break;
         }
@@ -307,23 +788,19 @@ QHash< int, QByteArray > ActivityModel::roleNames() const
     roles[ActivityNameRole] = "ActivityName";
     roles[ActivityTimeRole] = "ActivityTime";
     roles[ActivityPercentualUsage] = "ActivityPercentualUsage";
+    roles[ActivityCategoryRole] = "ActivityCategory";
+    roles[ActivitySecondsRole] = "ActivitySeconds";
 
     return roles;
 }
 
 QPixmap ActivityModel::currentActivityIcon() const
 {
-    if (d->currentActiveWindow.isEmpty()) {
-        return QIcon::fromTheme(QStringLiteral("plasma")).pixmap(QSize(64, 64));
-    }
-
-    for (auto it = d->list.constBegin(); it != d->list.constEnd(); ++it) {
-        if ((*it)->activityName() == d->currentActiveWindow) {
-            return (*it)->activityIcon().isNull() ? (*it)->activityDefaultIcon() : (*it)->activityIcon();
-        }
+    if (!d->currentItem || d->currentItem->activityIcon().isNull()) {
+        return d->defaultIcon;
     }
 
-    return QIcon::fromTheme(QStringLiteral("plasma")).pixmap(QSize(64, 64));
+    return d->currentItem->activityIcon();
 }
 
 QString ActivityModel::currentActivityName() const
@@ -337,27 +814,12 @@ QString ActivityModel::currentActivityName() const
 
 QString ActivityModel::currentActivityTime() const
 {
-    if (d->currentActiveWindow.isEmpty()) {
-        return QString();
-    }
-
-    for (auto it = d->list.constBegin(); it != d->list.constEnd(); ++it) {
-        if ((*it)->activityName() == d->currentActiveWindow) {
-            return (*it)->activityTime().toString(Qt::RFC2822Date);
-        }
-    }
-
-    return QString();
+    return d->currentTimeText;
 }
 
 QString ActivityModel::totalActivityTime() const
 {
-    QTime totalTime;
-    foreach (ActivityModelItem *item, d->list) {
-      totalTime = totalTime.addSecs(QTime(0, 0).secsTo(item->activityTime()));
-    }
-
-    return totalTime.toString(Qt::RFC2822Date);
+    return d->totalTimeText;
 }
 
 bool ActivityModel::timeTrackingEnabled() const
@@ -378,204 +840,590 @@ void ActivityModel::setTimeTrackingEnabled(bool enabled)
     }
 }
 
-void ActivityModel::setResetOnSuspend(bool reset)
+int ActivityModel::archiveAfterDays() const
 {
-    d->resetOnSuspend = reset;
+    return d->archiveAfterDays;
 }
 
-void ActivityModel::setResetOnShutdown(bool reset)
+void ActivityModel::setArchiveAfterDays(int days)
 {
-    d->resetOnShutdown = reset;
+    d->archiveAfterDays = days;
+
+    archiveUnusedActivities();
 }
 
-void ActivityModel::ignoreActivity(const QString &activityName)
+int ActivityModel::maximumIconCount() const
 {
-    if (!d->ignoredActivitiesList.contains(activityName)) {
-        d->ignoredActivitiesList.append(activityName);
+    return d->maximumIconCount;
+}
 
-        QList<ActivityModelItem*>::const_iterator otherIt;
-        QList<ActivityModelItem*>::const_iterator ignoredActivityIt;
+void ActivityModel::setMaximumIconCount(int count)
+{
+    d->maximumIconCount = count;
 
-        // Find if the "other applications" item exists
-        for (otherIt = d->list.constBegin(); otherIt != d->list.constEnd(); ++otherIt) {
-            if ((*otherIt)->activityName() == OTHER_APPLICATIONS_NAME) {
-                break;
-            }
-        }
+    evictIcons();
+}
 
-        // Find the item we don't want to monitor separately
-        for (ignoredActivityIt = d->list.constBegin(); ignoredActivityIt != d->list.constEnd(); ++ignoredActivityIt) {
-            if ((*ignoredActivityIt)->activityName() == activityName) {
-                break;
-            }
-        }
+int ActivityModel::currentDesktop() const
+{
+    return d->currentDesktop;
+}
 
-        KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
-        config->deleteGroup((*ignoredActivityIt)->configGroup());
+QString ActivityModel::currentKdeActivity() const
+{
+    return d->currentKdeActivity;
+}
 
-        // If "other applications" item doesn't exist, let's just rename the item we want to ignore
-        if (otherIt == d->list.constEnd()) {
-            (*ignoredActivityIt)->setActivityName(OTHER_APPLICATIONS_NAME);
-            (*ignoredActivityIt)->setActivityIcon(QPixmap());
-            (*ignoredActivityIt)->setConfigGroup(QStringLiteral("other"));
-            const int row = d->list.indexOf(((*ignoredActivityIt)));
-            if (row >= 0) {
-                QModelIndex index = createIndex(row, 0);
-                Q_EMIT dataChanged(index, index);
-            }
-        } else {
-            // Join the items together and remove the ignored activity
-            (*otherIt)->addSeconds(QTime(0,0).secsTo((*ignoredActivityIt)->activityTime()));
-            int row = d->list.indexOf((((*otherIt))));
-            if (row >= 0) {
-                QModelIndex index = createIndex(row, 0);
-                Q_EMIT dataChanged(index, index);
-            }
+qint64 ActivityModel::partitionSeconds(int row, int desktop, const QString &kdeActivity) const
+{
+    if (row < 0 || row >= d->list.count()) {
+        return 0;
+    }
 
-            // Remove the ignored activity
-            row = d->list.indexOf((*ignoredActivityIt));
-            if (row >= 0) {
-                beginRemoveRows(QModelIndex(), row, row);
-                (*ignoredActivityIt)->deleteLater();
-                d->list.removeAt(row);
-                endRemoveRows();
-            }
-        }
+    const quint32 item = d->list.at(row)->id();
 
-        KConfigGroup generalGroup(config, QStringLiteral("general"));
-        if (generalGroup.isValid()) {
-            generalGroup.writeEntry<QStringList>(QStringLiteral("ignoredActivities"), d->ignoredActivitiesList);
-        }
+    const int kdeActivityId = d->findKdeActivity(kdeActivity);
+    if (kdeActivityId == -2) {
+        return 0;
+    }
 
-       // Save it under "other" group
-        KConfigGroup otherGroup(config, "other");
-        if (otherGroup.isValid()) {
-            otherGroup.writeEntry(QStringLiteral("name"), OTHER_APPLICATIONS_NAME);
-            otherGroup.writeEntry(QStringLiteral("time"), (*ignoredActivityIt)->activityTime().toString(Qt::RFC2822Date));
-        }
+    // Fully specified partitions are a single lookup
+    if (desktop > 0 && kdeActivityId >= 0) {
+        return d->partitionSeconds.value(counterKey(partitionId(desktop, kdeActivityId), item));
+    }
 
-        if (d->currentActiveWindow == activityName) {
-            // Reset current item
-            d->currentActiveWindow = OTHER_APPLICATIONS_NAME;
-            Q_EMIT currentActivityChanged();
+    qint64 seconds = 0;
+    foreach (quint32 partition, d->partitions) {
+        if (d->partitionMatches(partition, desktop, kdeActivityId)) {
+            seconds += d->partitionSeconds.value(counterKey(partition, item));
         }
     }
+
+    return seconds;
 }
 
-void ActivityModel::inhibit()
+qint64 ActivityModel::partitionTotalSeconds(int desktop, const QString &kdeActivity) const
 {
-    if (d->inhibitFileDescriptor.isValid()) {
-        return;
-    }
-
-    QDBusMessage message = QDBusMessage::createMethodCall(LOGIN1_DBUS_SERVICE,
-                                                          LOGIN1_DBUS_PATH,
-                                                          LOGIN1_DBUS_MANAGER_INTERFACE,
-                                                          QStringLiteral("Inhibit"));
+    const int kdeActivityId = d->findKdeActivity(kdeActivity);
 
-    message.setArguments(QVariantList({QStringLiteral("shutdown:sleep"),
-                         i18n("Plasma Timekeeper"),
-                         i18n("Ensuring that the statistics get reseted on suspend or shutdown"),
-                         QStringLiteral("delay")}));
-    QDBusPendingReply<QDBusUnixFileDescriptor> reply = QDBusConnection::systemBus().asyncCall(message);
-    QDBusPendingCallWatcher *inhibitWatcher = new QDBusPendingCallWatcher(reply, this);
-    connect(inhibitWatcher, &QDBusPendingCallWatcher::finished, this,
-        [this](QDBusPendingCallWatcher *self) {
-            QDBusPendingReply<QDBusUnixFileDescriptor> reply = *self;
-            self->deleteLater();
-            if (!reply.isValid()) {
-                return;
-            }
-            reply.value().swap(d->inhibitFileDescriptor);
+    qint64 seconds = 0;
+    foreach (quint32 partition, d->partitions) {
+        if (d->partitionMatches(partition, desktop, kdeActivityId)) {
+            seconds += d->partitionTotals.value(partition);
         }
-    );
-}
-
-void ActivityModel::uninhibit()
-{
-    if (!d->inhibitFileDescriptor.isValid()) {
-        return;
     }
 
-    d->inhibitFileDescriptor = QDBusUnixFileDescriptor();
+    return seconds;
 }
 
-void ActivityModel::resetTimeStatistics()
+int ActivityModel::lastFlushLatency() const
 {
-    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+    return d->lastFlushLatency;
+}
 
-    foreach (ActivityModelItem *item, d->list) {
-        config->deleteGroup(item->configGroup());
+void ActivityModel::setResetOnSuspend(bool reset)
+{
+    d->resetOnSuspend = reset;
+}
 
-        const int row = d->list.indexOf(item);
-        if (row >= 0) {
-            beginRemoveRows(QModelIndex(), row, row);
-            item->deleteLater();
-            d->list.removeAt(row);
-            endRemoveRows();
+void ActivityModel::setResetOnShutdown(bool reset)
+{
+    d->resetOnShutdown = reset;
+}
+
+QVariantMap ActivityModel::statistics() const
+{
+#ifdef TIMEKEEPER_STATISTICS
+    return TimekeeperStatistics::self()->toVariantMap();
+#else
+    return QVariantMap();
+#endif
+}
+
+QStringList ActivityModel::usageLimits() const
+{
+    return d->limits->limits();
+}
+
+void ActivityModel::setUsageLimits(const QStringList &limits)
+{
+    if (d->limits->limits() == limits) {
+        return;
+    }
+
+    d->limits->setLimits(limits);
+    restoreLimitUsage();
+}
+
+QStringList ActivityModel::activityRules() const
+{
+    return d->rules.rules();
+}
+
+void ActivityModel::setActivityRules(const QStringList &rules)
+{
+    QStringList newRules = rules;
+
+    // The first rules set get the activities ignored by earlier versions
+    if (!d->legacyIgnoredActivities.isEmpty()) {
+        newRules.removeAll(QString());
+        foreach (const QString &activity, d->legacyIgnoredActivities) {
+            const QString rule = ActivityRules::ignoreRule(activity);
+            if (!newRules.contains(rule)) {
+                newRules << rule;
+            }
+        }
+        d->legacyIgnoredActivities.clear();
+
+        KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+        KConfigGroup generalGroup(config, QStringLiteral("general"));
+        generalGroup.deleteEntry(QStringLiteral("ignoredActivities"));
+        syncConfig(config);
+    }
+
+    if (d->rules.rules() == newRules && newRules == rules) {
+        return;
+    }
+
+    d->rules.setRules(newRules);
+
+    // Categories of already known activities might have changed
+    for (int row = 0; row < d->list.count(); row++) {
+        ActivityModelItem *item = d->list.at(row);
+        if (item->activityName() == OTHER_APPLICATIONS_NAME) {
+            continue;
+        }
+
+        // Activities stored before their window class was recorded only know their name
+        const QString windowClass = item->windowClass().isEmpty() ? item->activityName() : item->windowClass();
+        const QString category = d->rules.match(windowClass).category;
+        if (item->category() != category) {
+            item->setCategory(category);
+            QModelIndex index = createIndex(row, 0);
+            Q_EMIT dataChanged(index, index);
+        }
+    }
+
+    // Usage of today per category as well
+    restoreLimitUsage();
+
+    // Migrated rules have to be stored
+    if (newRules != rules) {
+        Q_EMIT activityRulesChanged();
+    }
+}
+
+void ActivityModel::ignoreActivity(const QString &activityName)
+{
+    // Ignored activities are plain rules, removing the rule tracks them again
+    const QString rule = ActivityRules::ignoreRule(activityName);
+    if (!d->rules.rules().contains(rule)) {
+        QStringList rules = d->rules.rules();
+        rules.removeAll(QString());
+        d->rules.setRules(rules << rule);
+        Q_EMIT activityRulesChanged();
+
+        ActivityModelItem *otherItem = 0;
+        ActivityModelItem *ignoredItem = 0;
+
+        foreach (ActivityModelItem *item, d->list) {
+            // Find if the "other applications" item exists
+            if (item->activityName() == OTHER_APPLICATIONS_NAME) {
+                otherItem = item;
+            }
+
+            // Find the item we don't want to monitor separately
+            if (item->activityName() == activityName) {
+                ignoredItem = item;
+            }
+        }
+
+        if (!ignoredItem) {
+            return;
+        }
+
+        KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+        config->deleteGroup(ignoredItem->configGroup());
+
+        // If "other applications" item doesn't exist, let's just rename the item we want to ignore
+        if (!otherItem) {
+            ignoredItem->setActivityName(OTHER_APPLICATIONS_NAME);
+            d->setIcon(ignoredItem, QPixmap());
+            d->iconCache.removeOne(ignoredItem);
+            ignoredItem->setCategory(QString());
+            ignoredItem->setConfigGroup(QStringLiteral("other"));
+            ignoredItem->setWindowClass(QString());
+            const int row = d->list.indexOf(ignoredItem);
+            if (row >= 0) {
+                QModelIndex index = createIndex(row, 0);
+                Q_EMIT dataChanged(index, index);
+            }
+            otherItem = ignoredItem;
+        } else {
+            // Join the items together and remove the ignored activity
+            otherItem->addSeconds(QTime(0,0).secsTo(ignoredItem->activityTime()));
+            foreach (quint32 partition, d->partitions) {
+                const qint64 seconds = d->partitionSeconds.value(counterKey(partition, ignoredItem->id()));
+                if (seconds) {
+                    d->addPartitionSeconds(partition, otherItem->id(), seconds);
+                }
+            }
+            int row = d->list.indexOf(otherItem);
+            if (row >= 0) {
+                QModelIndex index = createIndex(row, 0);
+                Q_EMIT dataChanged(index, index);
+            }
+
+            // Remove the ignored activity
+            removeItem(ignoredItem);
+        }
+
+       // Save it under "other" group
+        KConfigGroup otherGroup(config, "other");
+        if (otherGroup.isValid()) {
+            otherGroup.writeEntry(QStringLiteral("name"), OTHER_APPLICATIONS_NAME);
+            otherGroup.writeEntry(QStringLiteral("time"), otherItem->activityTime().toString(Qt::RFC2822Date));
+            d->writePartitions(otherItem, otherGroup);
+        }
+
+        if (d->currentItem == ignoredItem) {
+            // Reset current item
+            setCurrentItem(otherItem);
+        }
+    }
+}
+
+void ActivityModel::inhibit()
+{
+    if (d->inhibitFileDescriptor.isValid()) {
+        return;
+    }
+
+    QDBusMessage message = QDBusMessage::createMethodCall(LOGIN1_DBUS_SERVICE,
+                                                          LOGIN1_DBUS_PATH,
+                                                          LOGIN1_DBUS_MANAGER_INTERFACE,
+                                                          QStringLiteral("Inhibit"));
+
+    message.setArguments(QVariantList({QStringLiteral("shutdown:sleep"),
+                         i18n("Plasma Timekeeper"),
+                         i18n("Ensuring that the statistics get reseted on suspend or shutdown"),
+                         QStringLiteral("delay")}));
+    QDBusPendingReply<QDBusUnixFileDescriptor> reply = QDBusConnection::systemBus().asyncCall(message);
+    QDBusPendingCallWatcher *inhibitWatcher = new QDBusPendingCallWatcher(reply, this);
+    connect(inhibitWatcher, &QDBusPendingCallWatcher::finished, this,
+        [this](QDBusPendingCallWatcher *self) {
+            QDBusPendingReply<QDBusUnixFileDescriptor> reply = *self;
+            self->deleteLater();
+            if (!reply.isValid()) {
+                return;
+            }
+            reply.value().swap(d->inhibitFileDescriptor);
         }
+    );
+}
+
+void ActivityModel::uninhibit()
+{
+    if (!d->inhibitFileDescriptor.isValid()) {
+        return;
     }
 
+    d->inhibitFileDescriptor = QDBusUnixFileDescriptor();
+}
+
+void ActivityModel::resetTimeStatistics()
+{
+    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+
     // Reset current item
-    d->currentActiveWindow = QString();
-    d->currentTime = QTime::currentTime();
-    Q_EMIT currentActivityChanged();
+    setCurrentItem(0);
+    d->currentTime = TimekeeperClock::currentTime();
 
-    // If time tracking is not enabled we don't need to start it again
-    if (d->timeTrackingEnabled) {
-        activeWindowChanged(KWindowSystem::activeWindow());
+    // Time of windows still waiting for their class goes as well, the history
+    // is not reset and gets what was held back for them
+    d->pendingIntervals.clear();
+    d->activeWindowTime = d->currentTime;
+
+    foreach (ActivityModelItem *item, d->list) {
+        removeItem(item);
     }
+
+    // Archived activities are not in the list anymore, but their time is
+    foreach (const QString &groupName, config->groupList()) {
+        if (groupName != QStringLiteral("general")) {
+            config->deleteGroup(groupName);
+        }
+    }
+
+    KConfigGroup generalGroup(config, QStringLiteral("general"));
+    if (generalGroup.hasKey(QStringLiteral("resetPending"))) {
+        generalGroup.deleteEntry(QStringLiteral("resetPending"));
+    }
+
+    d->totalSeconds = 0;
+    d->partitions.clear();
+    d->partitionSeconds.clear();
+    d->partitionTotals.clear();
+    updateFormattedTimes();
+
+    syncConfig(config);
+
+    // Deleted groups are only marked as such until the config is read again
+    config->reparseConfiguration();
+
+    // If time tracking is not enabled or we are about to suspend we don't need to start it again
+    updateTrackingState();
+}
+
+void ActivityModel::dumpStatistics()
+{
+#ifdef TIMEKEEPER_STATISTICS
+    qCInfo(PLASMA_TIMEKEEPER).noquote() << "Statistics:\n" + TimekeeperStatistics::self()->toString();
+#else
+    qCInfo(PLASMA_TIMEKEEPER) << "Built without statistics support";
+#endif
+}
+
+void ActivityModel::limitReached(const QString &name, int minutes)
+{
+    Q_EMIT usageLimitReached(name, minutes);
+
+    const QString target = name.startsWith(QLatin1Char('@')) ? name.mid(1) : name;
+
+    QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.Notifications"),
+                                                          QStringLiteral("/org/freedesktop/Notifications"),
+                                                          QStringLiteral("org.freedesktop.Notifications"),
+                                                          QStringLiteral("Notify"));
+
+    message.setArguments(QVariantList({i18n("Plasma Timekeeper"),
+                                       0u,
+                                       QStringLiteral("utilities-system-monitor"),
+                                       i18n("Usage limit reached"),
+                                       i18np("You have used %2 for more than %1 minute today.", "You have used %2 for more than %1 minutes today.", minutes, target),
+                                       QStringList(),
+                                       QVariantMap(),
+                                       -1}));
+    QDBusConnection::sessionBus().asyncCall(message);
 }
 
 void ActivityModel::activeWindowChanged(WId window)
 {
-    KWindowInfo info = KWindowInfo(window, NET::WMName | NET::WMIconName, NET::WM2WindowClass);
-    const QString activityName = d->ignoredActivitiesList.contains(info.windowClassName()) ? OTHER_APPLICATIONS_NAME : info.windowClassName();
-    const QString configGroup = d->ignoredActivitiesList.contains(info.windowClassName()) ? QStringLiteral("other") : info.windowClassName();
+    TIMEKEEPER_STATISTICS_SCOPE(FocusChangeProbe);
+
+    const QTime now = TimekeeperClock::currentTime();
 
-    qCDebug(PLASMA_TIMEKEEPER) << "Active window changed to " << info.windowClassName();
+    // The window losing focus might still be waiting for its class
+    closePendingInterval(now);
 
-    if (info.windowClassName().isEmpty()) {
+    d->activeWindow = window;
+    d->activeWindowTime = now;
+
+    if (!d->focusBackend->isResolved(window)) {
+        // Don't block on the display server. The current activity ends here and the
+        // time from now on is kept for the window until we know its class
+        accountActivityTime(now);
+        setCurrentItem(0);
+
+        if (window) {
+            d->activeWindowPending = d->trackingActive();
+            d->focusBackend->resolve(window);
+        }
         return;
     }
 
-    // Process the current activity
-    updateCurrentActivityTime();
+    setCurrentActivity(window, now);
+}
 
-    if (!d->timeTrackingEnabled) {
-        qCDebug(PLASMA_TIMEKEEPER) << "Monitoring is disabled";
+void ActivityModel::windowResolved(WId window)
+{
+    TIMEKEEPER_STATISTICS_SCOPE(FocusChangeProbe);
+
+    const QVector<Private::PendingInterval> intervals = d->pendingIntervals.take(window);
+
+    if (window == d->activeWindow && d->activeWindowPending) {
+        d->activeWindowPending = false;
+        setCurrentActivity(window, d->activeWindowTime);
+    } else if (window == d->activeWindow && d->trackingActive()) {
+        // The class of the active window changed
+        setCurrentActivity(window, TimekeeperClock::currentTime());
+    }
+
+    if (intervals.isEmpty()) {
         return;
     }
 
-    // Find if the activity already exists and if not add it to the model
-    QList<ActivityModelItem*>::const_iterator it;
-    for (it = d->list.constBegin(); it != d->list.constEnd(); ++it) {
-        if ((*it)->activityName() == activityName) {
-            break;
+    // Earlier visits of the window, it already lost focus again before we knew its class
+    ActivityModelItem *item = activityItem(window);
+    if (!item) {
+        qCDebug(PLASMA_TIMEKEEPER) << "Discarding time of window without class" << window;
+        return;
+    }
+
+    foreach (const Private::PendingInterval &interval, intervals) {
+        creditActivityTime(item, interval.seconds, interval.end, interval.partition);
+    }
+
+    const int row = d->list.indexOf(item);
+    if (row >= 0) {
+        QModelIndex index = createIndex(row, 0);
+        Q_EMIT dataChanged(index, index);
+    }
+    updateFormattedTimes();
+}
+
+void ActivityModel::iconResolved(WId window)
+{
+    const QString windowClass = d->focusBackend->windowClass(window);
+    if (windowClass.isEmpty()) {
+        return;
+    }
+
+    const ActivityRules::Result rule = d->rules.match(windowClass);
+    if (rule.ignored) {
+        return;
+    }
+
+    for (int row = 0; row < d->list.count(); row++) {
+        ActivityModelItem *item = d->list.at(row);
+        if (item->activityName() != rule.name) {
+            continue;
+        }
+
+        if (item->activityIcon().isNull()) {
+            d->setIcon(item, d->focusBackend->windowIcon(window));
+            touchIcon(item);
+
+            QModelIndex index = createIndex(row, 0);
+            Q_EMIT dataChanged(index, index, QVector<int>() << ActivityIconRole);
+
+            if (item == d->currentItem) {
+                Q_EMIT currentActivityIconChanged();
+            }
         }
+        break;
     }
+}
 
-    if (it == d->list.constEnd()) {
-        qCDebug(PLASMA_TIMEKEEPER) << "Adding new activity item " << activityName;
-        ActivityModelItem *item = new ActivityModelItem(this);
-        item->setActivityName(activityName);
-        item->setActivityDefaultIcon(QIcon::fromTheme(QStringLiteral("plasma")).pixmap(QSize(64, 64)));
-        item->setActivityIcon(KWindowSystem::icon(window, 64, 64, true));
-        item->setActivityTime(QTime(0, 0, 0));
-        item->setConfigGroup(configGroup);
+void ActivityModel::closePendingInterval(const QTime &until)
+{
+    if (!d->activeWindowPending) {
+        return;
+    }
 
-        const int index = d->list.count();
-        beginInsertRows(QModelIndex(), index, index);
-        d->list << item;
-        endInsertRows();
-    } else if ((*it)->activityIcon().isNull() && activityName != OTHER_APPLICATIONS_NAME) { // Update icon to avoid using the default one
-        (*it)->setActivityIcon(KWindowSystem::icon(window, 64, 64, true));
-        const int row = d->list.indexOf((*it));
-        if (row >= 0) {
+    d->activeWindowPending = false;
+
+    Private::PendingInterval interval;
+    interval.end = toDateTime(until);
+    interval.seconds = secondsBetween(d->activeWindowTime, until);
+    interval.partition = d->currentPartition;
+
+    if (interval.seconds > 0) {
+        d->pendingIntervals[d->activeWindow] << interval;
+    }
+}
+
+ActivityModelItem *ActivityModel::activityItem(WId window)
+{
+    const QString windowClass = d->focusBackend->windowClass(window);
+    if (windowClass.isEmpty()) {
+        return 0;
+    }
+
+    const ActivityRules::Result rule = d->rules.match(windowClass);
+    const QString activityName = rule.ignored ? OTHER_APPLICATIONS_NAME : rule.name;
+    const QString configGroup = rule.ignored ? QStringLiteral("other") : rule.name;
+
+    // Find if the activity already exists and if not add it to the model
+    for (int row = 0; row < d->list.count(); row++) {
+        ActivityModelItem *item = d->list.at(row);
+        if (item->activityName() != activityName) {
+            continue;
+        }
+
+        if (activityName == OTHER_APPLICATIONS_NAME) {
+            return item;
+        }
+
+        if (item->windowClass().isEmpty()) {
+            item->setWindowClass(windowClass);
+
+            KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+            KConfigGroup group(config, item->configGroup());
+            if (group.isValid()) {
+                group.writeEntry(QStringLiteral("windowClass"), windowClass);
+            }
+        }
+
+        // Update icon to avoid using the default one, a missing icon is announced later
+        bool changed = false;
+        if (item->activityIcon().isNull()) {
+            d->setIcon(item, d->focusBackend->windowIcon(window));
+            changed = !item->activityIcon().isNull();
+        }
+        if (item->category() != rule.category) {
+            item->setCategory(rule.category);
+            changed = true;
+        }
+
+        if (changed) {
             QModelIndex index = createIndex(row, 0);
             Q_EMIT dataChanged(index, index);
+
+            if (item == d->currentItem) {
+                Q_EMIT currentActivityIconChanged();
+            }
         }
+
+        return item;
+    }
+
+    qCDebug(PLASMA_TIMEKEEPER) << "Adding new activity item " << activityName;
+    ActivityModelItem *item = new ActivityModelItem(this);
+    item->setActivityName(activityName);
+    d->setIcon(item, rule.ignored ? QPixmap() : d->focusBackend->windowIcon(window));
+    item->setCategory(rule.category);
+    item->setConfigGroup(configGroup);
+    item->setId(d->nextItemId++);
+
+    // Archived activities continue with their stored time
+    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+    KConfigGroup group(config, configGroup);
+    if (!rule.ignored) {
+        item->setWindowClass(windowClass);
+        group.writeEntry(QStringLiteral("windowClass"), windowClass);
     }
+    const QTime storedTime = QTime::fromString(group.readEntry(QStringLiteral("time"), QString()));
+    item->setActivityTime(storedTime.isValid() ? storedTime : QTime(0, 0, 0));
+    d->totalSeconds += QTime(0, 0).secsTo(item->activityTime());
+    d->loadPartitions(item, group);
+
+    const int index = d->list.count();
+    beginInsertRows(QModelIndex(), index, index);
+    d->list << item;
+    endInsertRows();
+
+    return item;
+}
+
+void ActivityModel::setCurrentActivity(WId window, const QTime &since)
+{
+    const QString windowClass = d->focusBackend->windowClass(window);
+
+    qCDebug(PLASMA_TIMEKEEPER) << "Active window changed to " << windowClass;
+
+    if (windowClass.isEmpty()) {
+        return;
+    }
+
+    // Process the current activity up to the moment the window got focus
+    accountActivityTime(since);
+
+    if (!d->timeTrackingEnabled) {
+        qCDebug(PLASMA_TIMEKEEPER) << "Monitoring is disabled";
+        return;
+    }
+
+    ActivityModelItem *item = activityItem(window);
 
     // Process the next activity
     if (!d->timeTrackingEnabled && !d->screenLocked) {
@@ -586,9 +1434,8 @@ void ActivityModel::activeWindowChanged(WId window)
     }
 
     // Save current time and activity
-    d->currentActiveWindow = activityName;
-    d->currentTime = QTime::currentTime();
-    Q_EMIT currentActivityChanged();
+    d->currentTime = since;
+    setCurrentItem(item);
 }
 
 void ActivityModel::lockscreenActivityChanged(bool active)
@@ -602,15 +1449,11 @@ void ActivityModel::prepareForSleepChanged(bool sleep)
 {
     d->preparingForSleep = sleep;
 
-    updateTrackingState();
-
-    if (d->preparingForSleep && d->resetOnSuspend) {
-        resetTimeStatistics();
-    }
-
     if (d->preparingForSleep) {
-        uninhibit();
+        flushAndUninhibit(d->resetOnSuspend);
     } else {
+        updateTrackingState();
+
         // Inhibit again to be sure that the next suspend will also reset and update the stats
         inhibit();
     }
@@ -624,79 +1467,445 @@ void ActivityModel::prepareForShutdownChanged(bool shutdown)
 
     d->preparingForShutdown = shutdown;
 
+    if (d->preparingForShutdown) {
+        flushAndUninhibit(d->resetOnShutdown);
+    } else {
+        // The shutdown has been cancelled
+        updateTrackingState();
+        inhibit();
+    }
+}
+
+void ActivityModel::flushAndUninhibit(bool reset)
+{
+    TIMEKEEPER_STATISTICS_SCOPE(SleepFlushProbe);
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    // Close the current interval, logind only waits for a single config write
+    d->configSyncDeferred = true;
     updateTrackingState();
+    d->configSyncDeferred = false;
 
-    if (d->preparingForShutdown && d->resetOnShutdown) {
-        resetTimeStatistics();
-        uninhibit();
+    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+
+    // Resetting is done once logind went on, if we don't get that far (shutdown)
+    // the next start does it
+    if (reset) {
+        KConfigGroup generalGroup(config, QStringLiteral("general"));
+        if (generalGroup.isValid()) {
+            generalGroup.writeEntry(QStringLiteral("resetPending"), true);
+        }
     }
 
-    // Probably no reason to start the inhibitor again as the applet will
-    // be reloaded completely with already running inhibitor
+    syncConfig(config);
+    writeHistory();
+    uninhibit();
+
+    d->lastFlushLatency = elapsed.elapsed();
+    Q_EMIT lastFlushLatencyChanged();
+
+    if (d->lastFlushLatency > FLUSH_DEADLINE) {
+        qCWarning(PLASMA_TIMEKEEPER) << "Flushing before suspend or shutdown took" << d->lastFlushLatency << "ms, deadline is" << FLUSH_DEADLINE << "ms";
+    } else {
+        qCDebug(PLASMA_TIMEKEEPER) << "Flushed before suspend or shutdown in" << d->lastFlushLatency << "ms";
+    }
+
+    if (reset) {
+        resetTimeStatistics();
+    }
 }
 
 void ActivityModel::updateCurrentActivityTime()
 {
-    QTime totalTime(0, 0);
+    accountActivityTime(TimekeeperClock::currentTime());
+}
 
-    // Get the total time + update the current item
-    foreach (ActivityModelItem *item, d->list) {
-        // Update current activity time
-        if (d->currentActiveWindow == item->activityName()) {
-            item->addSeconds(d->currentTime.secsTo(QTime::currentTime()));
+void ActivityModel::accountActivityTime(const QTime &until)
+{
+    TIMEKEEPER_STATISTICS_SCOPE(TickProbe);
+
+    // Update the current item
+    if (d->currentItem) {
+        creditActivityTime(d->currentItem, secondsBetween(d->currentTime, until), toDateTime(until), d->currentPartition, d->switchedSeconds);
+        d->checkpoint.flushed();
+    }
+    d->switchedSeconds = 0;
+    d->switchedPartitions.clear();
+
+    for (int row = 0; row < d->list.count(); row++) {
+        ActivityModelItem *item = d->list.at(row);
+
+        // Update percentual usage according to the total time
+        const int itemTimeSecs = QTime(0, 0).secsTo(item->activityTime());
+        const int percentualUsage = d->totalSeconds && itemTimeSecs ? (double) itemTimeSecs / ((double) d->totalSeconds / (double) 100) : 0;
+
+        // Only rows with something new to show are announced
+        if (item == d->currentItem || item->percentualUsage() != percentualUsage) {
+            item->setPercentualUsage(percentualUsage);
+            QModelIndex index = createIndex(row, 0);
+            Q_EMIT dataChanged(index, index);
+        }
+    }
+
+    updateFormattedTimes();
+
+#ifdef TIMEKEEPER_STATISTICS
+    TIMEKEEPER_STATISTICS_SET(TrackedItemsGauge, d->list.count());
+    TIMEKEEPER_STATISTICS_SET(TrackedItemsMemoryGauge, d->iconMemory);
+    Q_EMIT statisticsChanged();
+#endif
+
+    if (d->timeTrackingEnabled) {
+        d->currentTime = until;
+        d->timer.start(60000);
+    }
+}
+
+void ActivityModel::creditActivityTime(ActivityModelItem *item, int secs, const QDateTime &end, quint32 partition, int switchedSecs)
+{
+    item->addSeconds(secs);
+    d->totalSeconds += secs;
+    d->addPartitionSeconds(partition, item->id(), qMax(secs - switchedSecs, 0));
+    d->limits->addUsage(item->activityName(), item->category(), secs);
+
+    // Store the new updated value
+    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+    KConfigGroup group(config, item->configGroup());
+    if (group.isValid()) {
+        if (!group.hasKey(QStringLiteral("name"))) {
+            group.writeEntry(QStringLiteral("name"), item->activityName());
+        }
+        group.writeEntry(QStringLiteral("time"), item->activityTime().toString(Qt::RFC2822Date));
+        group.writeEntry(d->partitionEntry(partition), d->partitionSeconds.value(counterKey(partition, item->id())));
+
+        // Partitions left since the last tick got their time already, it wasn't stored yet
+        if (switchedSecs > 0) {
+            foreach (quint32 switchedPartition, d->switchedPartitions) {
+                group.writeEntry(d->partitionEntry(switchedPartition), d->partitionSeconds.value(counterKey(switchedPartition, item->id())));
+            }
+        }
+    }
+    if (!d->configSyncDeferred) {
+        syncConfig(config);
+    }
+
+    if (secs > 0) {
+        Private::HistoryRecord record;
+        record.name = item->activityName();
+        record.start = end.addSecs(-secs);
+        record.seconds = secs;
+
+        auto it = std::upper_bound(d->historyQueue.begin(), d->historyQueue.end(), record.start, [] (const QDateTime &start, const Private::HistoryRecord &queued) {
+            return start < queued.start;
+        });
+        d->historyQueue.insert(it, record);
+    }
+}
+
+void ActivityModel::writeHistory()
+{
+    // Windows which never get their class must not hold back the history forever,
+    // their time is dropped instead
+    if (d->historyQueue.count() > MAX_QUEUED_HISTORY) {
+        qCWarning(PLASMA_TIMEKEEPER) << "Discarding time of windows still waiting for their class";
+        d->pendingIntervals.clear();
+        d->activeWindowTime = TimekeeperClock::currentTime();
+    }
+
+    const QDateTime pendingSince = d->pendingSince();
+
+    // A single batch under the lock, which isn't waited for. If another writer
+    // holds it the queue is kept for the next try.
+    int written = 0;
+    d->history.setBuffered(true);
+    while (written < d->historyQueue.count() && (!pendingSince.isValid() || d->historyQueue.at(written).start < pendingSince)) {
+        const Private::HistoryRecord &record = d->historyQueue.at(written);
+        if (!d->history.append(record.name, record.start, record.seconds)) {
+            qCDebug(PLASMA_TIMEKEEPER) << "History is busy or not writable, trying again later" << d->history.path();
+            break;
+        }
+        written++;
+    }
+    d->history.setBuffered(false);
+
+    d->historyQueue.remove(0, written);
+
+    if (d->historyQueue.count() > MAX_QUEUED_HISTORY) {
+        qCWarning(PLASMA_TIMEKEEPER) << "Failed to write the history for long, discarding its oldest intervals" << d->history.path();
+        d->historyQueue.remove(0, d->historyQueue.count() - MAX_QUEUED_HISTORY);
+    }
+}
+
+void ActivityModel::setCurrentItem(ActivityModelItem *item)
+{
+    const QString name = item ? item->activityName() : QString();
+
+    if (item) {
+        d->checkpoint.startInterval(item->configGroup(), secondsBetween(d->currentTime, TimekeeperClock::currentTime()) * qint64(1000));
+        d->heartbeatTimer.start();
+        d->limits->setCurrentActivity(item->activityName(), item->category());
+        touchIcon(item);
+
+        if (item->lastUsed() != TimekeeperClock::currentDate()) {
+            item->setLastUsed(TimekeeperClock::currentDate());
 
-            // Store the new updated value
             KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
             KConfigGroup group(config, item->configGroup());
             if (group.isValid()) {
-                if (!group.hasKey(QStringLiteral("name"))) {
-                    group.writeEntry(QStringLiteral("name"), item->activityName());
-                }
-                group.writeEntry(QStringLiteral("time"), item->activityTime().toString(Qt::RFC2822Date));
+                group.writeEntry(QStringLiteral("lastUsed"), item->lastUsed().toString(Qt::ISODate));
             }
         }
+    } else {
+        d->checkpoint.stopInterval();
+        d->heartbeatTimer.stop();
+        d->limits->setCurrentActivity(QString(), QString());
+    }
 
-        totalTime = totalTime.addSecs(QTime(0, 0).secsTo(item->activityTime()));
+    if (d->currentItem != item) {
+        d->currentItem = item;
+        d->switchedSeconds = 0;
+        d->switchedPartitions.clear();
+        Q_EMIT currentActivityIconChanged();
     }
 
-    foreach (ActivityModelItem *item, d->list) {
-        // Update percentual usage according to the total time
-        const int totalTimeSecs = QTime(0, 0).secsTo(totalTime);
-        const int itemTimeSecs = QTime(0, 0).secsTo(item->activityTime());
+    if (d->currentActiveWindow != name) {
+        d->currentActiveWindow = name;
+        Q_EMIT currentActivityNameChanged();
+    }
 
-        if (totalTimeSecs && itemTimeSecs) {
-            item->setPercentualUsage((double) itemTimeSecs / ((double) totalTimeSecs / (double) 100));
-        } else {
-            item->setPercentualUsage(0);
-        }
+    updateFormattedTimes();
+}
+
+void ActivityModel::removeItem(ActivityModelItem *item)
+{
+    const int row = d->list.indexOf(item);
+    if (row < 0) {
+        return;
+    }
+
+    d->iconCache.removeOne(item);
+    d->setIcon(item, QPixmap());
+    d->forgetPartitions(item);
+
+    beginRemoveRows(QModelIndex(), row, row);
+    item->deleteLater();
+    d->list.removeAt(row);
+    endRemoveRows();
+}
+
+void ActivityModel::touchIcon(ActivityModelItem *item)
+{
+    d->iconCache.removeOne(item);
+
+    if (item->activityIcon().isNull()) {
+        return;
+    }
+
+    d->iconCache.prepend(item);
+    evictIcons();
+}
+
+void ActivityModel::evictIcons()
+{
+    // Evicted icons are fetched again once the activity gets focus
+    while (d->maximumIconCount > 0 && d->iconCache.count() > d->maximumIconCount) {
+        ActivityModelItem *item = d->iconCache.takeLast();
+        d->setIcon(item, QPixmap());
 
         const int row = d->list.indexOf(item);
         if (row >= 0) {
             QModelIndex index = createIndex(row, 0);
-            Q_EMIT dataChanged(index, index);
+            Q_EMIT dataChanged(index, index, QVector<int>() << ActivityIconRole);
         }
     }
+}
 
-    Q_EMIT currentActivityChanged();
+void ActivityModel::archiveUnusedActivities()
+{
+    if (d->archiveAfterDays <= 0) {
+        return;
+    }
 
-    if (d->timeTrackingEnabled) {
-        d->currentTime = QTime::currentTime();
-        d->timer.start(60000);
+    // Only the items are dropped, their config groups stay so the time is back
+    // once the activity is used again
+    const QDate archiveBefore = TimekeeperClock::currentDate().addDays(-d->archiveAfterDays);
+    bool archived = false;
+
+    foreach (ActivityModelItem *item, d->list) {
+        if (item == d->currentItem || item->lastUsed() >= archiveBefore) {
+            continue;
+        }
+
+        qCDebug(PLASMA_TIMEKEEPER) << "Archiving" << item->activityName() << "last used" << item->lastUsed();
+
+        d->totalSeconds -= QTime(0, 0).secsTo(item->activityTime());
+        removeItem(item);
+        archived = true;
+    }
+
+    if (archived) {
+        updateFormattedTimes();
+    }
+}
+
+void ActivityModel::currentDesktopChanged(int desktop)
+{
+    setCurrentPartition(desktop, d->currentKdeActivity);
+}
+
+void ActivityModel::currentKdeActivityChanged(const QString &kdeActivity)
+{
+    setCurrentPartition(d->currentDesktop, kdeActivity);
+}
+
+void ActivityModel::setCurrentPartition(int desktop, const QString &kdeActivity)
+{
+    if (desktop == d->currentDesktop && kdeActivity == d->currentKdeActivity) {
+        return;
+    }
+
+    // Time until now still belongs to the previous partition. Only its counter is
+    // updated, storing the time and everything else is left to the next tick.
+    const QTime now = TimekeeperClock::currentTime();
+    if (d->currentItem) {
+        const int secs = secondsBetween(d->currentTime, now) - d->switchedSeconds;
+        if (secs > 0) {
+            d->addPartitionSeconds(d->currentPartition, d->currentItem->id(), secs);
+            d->switchedSeconds += secs;
+            if (!d->switchedPartitions.contains(d->currentPartition)) {
+                d->switchedPartitions << d->currentPartition;
+            }
+        }
+    }
+
+    // Same for a window still waiting for its class
+    if (d->activeWindowPending) {
+        closePendingInterval(now);
+        d->activeWindowPending = true;
+        d->activeWindowTime = now;
+    }
+
+    d->currentDesktop = desktop;
+    d->currentKdeActivity = kdeActivity;
+    d->currentPartition = partitionId(desktop, d->kdeActivityId(kdeActivity));
+    d->checkpoint.setPartition(desktop, kdeActivity);
+
+    Q_EMIT currentPartitionChanged();
+}
+
+void ActivityModel::recoverCheckpoint()
+{
+    ActivityCheckpoint::Interval interval;
+
+    if (!d->checkpoint.recover(&interval)) {
+        return;
+    }
+
+    // Activities removed meanwhile are discarded together with their time
+    foreach (ActivityModelItem *item, d->list) {
+        if (item->configGroup() != interval.configGroup) {
+            continue;
+        }
+
+        qCDebug(PLASMA_TIMEKEEPER) << "Recovered" << interval.seconds << "seconds of" << item->activityName();
+
+        // Counted like any other tick, just for the partition and time of the previous instance
+        const quint32 partition = partitionId(interval.desktop, d->kdeActivityId(interval.kdeActivity));
+        creditActivityTime(item, interval.seconds, interval.end, partition);
+        break;
+    }
+}
+
+void ActivityModel::restoreLimitUsage()
+{
+    // Usage limits are daily, so only the part of today counts
+    const qint64 midnight = QDateTime(TimekeeperClock::currentDate(), QTime(0, 0)).toMSecsSinceEpoch();
+
+    QHash<QString, qint64> seconds;
+
+    ActivityHistory history(d->history.path());
+    if (history.open()) {
+        QVector<qint64> indexes;
+        const qint64 first = history.firstIntersecting(midnight, &indexes);
+        for (qint64 i = first; i < history.count(); i++) {
+            indexes << i;
+        }
+
+        const QStringList names = history.activities();
+        foreach (qint64 index, indexes) {
+            const ActivityHistory::Interval &interval = history.intervals()[index];
+            const qint64 end = interval.start + qint64(interval.seconds) * 1000;
+            if (end > midnight) {
+                seconds[names.value(interval.activity)] += (end - qMax(interval.start, midnight)) / 1000;
+            }
+        }
+    }
+
+    // Not written yet
+    foreach (const Private::HistoryRecord &record, d->historyQueue) {
+        const qint64 start = record.start.toMSecsSinceEpoch();
+        const qint64 end = start + qint64(record.seconds) * 1000;
+        if (end > midnight) {
+            seconds[record.name] += (end - qMax(start, midnight)) / 1000;
+        }
+    }
+
+    // The history only knows names, known activities know their category
+    QHash<QString, QString> knownCategories;
+    foreach (ActivityModelItem *item, d->list) {
+        knownCategories.insert(item->activityName(), item->category());
+    }
+
+    QHash<QString, qint64> activities;
+    QHash<QString, qint64> categories;
+
+    for (auto it = seconds.constBegin(); it != seconds.constEnd(); ++it) {
+        const QString &name = it.key();
+        activities[name] += it.value();
+
+        auto known = knownCategories.constFind(name);
+        const QString category = known != knownCategories.constEnd() ? *known : d->rules.match(name).category;
+
+        if (!category.isEmpty()) {
+            categories[category] += it.value();
+        }
+    }
+
+    d->limits->setUsage(activities, categories);
+}
+
+void ActivityModel::updateFormattedTimes()
+{
+    // Empty when there is no current activity
+    const qint64 currentSeconds = d->currentItem ? QTime(0, 0).secsTo(d->currentItem->activityTime()) : -1;
+    if (currentSeconds != d->currentTimeTextSeconds) {
+        d->currentTimeTextSeconds = currentSeconds;
+        d->currentTimeText = currentSeconds >= 0 ? formatDuration(currentSeconds) : QString();
+        Q_EMIT currentActivityTimeChanged();
+    }
+
+    if (d->totalSeconds != d->totalTimeTextSeconds) {
+        d->totalTimeTextSeconds = d->totalSeconds;
+        d->totalTimeText = formatDuration(d->totalSeconds);
+        Q_EMIT totalActivityTimeChanged();
     }
 }
 
 void ActivityModel::updateTrackingState()
 {
-    if (d->timeTrackingEnabled && !d->screenLocked && !d->preparingForSleep && !d->preparingForShutdown) {
+    if (d->trackingActive()) {
         // Start again with current active window
-        activeWindowChanged(KWindowSystem::activeWindow());
+        activeWindowChanged(d->focusBackend->activeWindow());
     } else {
         // Add remaining seconds
+        closePendingInterval(TimekeeperClock::currentTime());
         updateCurrentActivityTime();
 
         // Reset current item and stop the timer
-        d->currentActiveWindow = QString();
-        d->currentTime = QTime::currentTime();
+        setCurrentItem(0);
+        d->currentTime = TimekeeperClock::currentTime();
         d->timer.stop();
     }
 }
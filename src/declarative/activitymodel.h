@@ -22,12 +22,16 @@
 #define PLASMA_TIMEKEEPER_ACTIVITY_MODEL_H
 
 #include <QAbstractListModel>
+#include <QDate>
+#include <QDateTime>
 #include <QTime>
 #include <QTimer>
 #include <QWindow>
 
 #include <KWindowSystem>
 
+class FocusBackend;
+
 /*                          ActivityModelItem                              *
  * ----------------------------------------------------------------------- */
 
@@ -41,18 +45,29 @@ public:
     void setActivityIcon(const QPixmap &icon);
     QPixmap activityIcon() const;
 
-    void setActivityDefaultIcon(const QPixmap &icon);
-    QPixmap activityDefaultIcon() const;
-
     void setActivityName(const QString &name);
     QString activityName() const;
 
     void setActivityTime(const QTime &time);
     QTime activityTime() const;
 
+    void setCategory(const QString &category);
+    QString category() const;
+
     void setConfigGroup(const QString &group);
     QString configGroup() const;
 
+    // Window class the activity was created for, rules are matched against it
+    void setWindowClass(const QString &windowClass);
+    QString windowClass() const;
+
+    void setLastUsed(const QDate &date);
+    QDate lastUsed() const;
+
+    // Stable id of the item, used in keys of the partition counters
+    void setId(quint32 id);
+    quint32 id() const;
+
     void setPercentualUsage(int percentualUsage);
     int percentualUsage() const;
 
@@ -69,23 +84,36 @@ private:
 class ActivityModel : public QAbstractListModel
 {
 Q_OBJECT
-Q_PROPERTY(QPixmap currentActivityIcon READ currentActivityIcon NOTIFY currentActivityChanged)
-Q_PROPERTY(QString currentActivityName READ currentActivityName NOTIFY currentActivityChanged)
-Q_PROPERTY(QString currentActivityTime READ currentActivityTime NOTIFY currentActivityChanged)
-Q_PROPERTY(QString totalActivityTime READ totalActivityTime)
+Q_CLASSINFO("D-Bus Interface", "org.kde.plasma.timekeeper.Statistics")
+Q_PROPERTY(QPixmap currentActivityIcon READ currentActivityIcon NOTIFY currentActivityIconChanged)
+Q_PROPERTY(QString currentActivityName READ currentActivityName NOTIFY currentActivityNameChanged)
+Q_PROPERTY(QString currentActivityTime READ currentActivityTime NOTIFY currentActivityTimeChanged)
+Q_PROPERTY(QString totalActivityTime READ totalActivityTime NOTIFY totalActivityTimeChanged)
 Q_PROPERTY(bool timeTrackingEnabled READ timeTrackingEnabled WRITE setTimeTrackingEnabled NOTIFY timeTrackingEnabledChanged)
 Q_PROPERTY(bool resetOnSuspend WRITE setResetOnSuspend)
 Q_PROPERTY(bool resetOnShutdown WRITE setResetOnShutdown)
+Q_PROPERTY(int lastFlushLatency READ lastFlushLatency NOTIFY lastFlushLatencyChanged)
+Q_PROPERTY(QStringList activityRules READ activityRules WRITE setActivityRules NOTIFY activityRulesChanged)
+Q_PROPERTY(QStringList usageLimits READ usageLimits WRITE setUsageLimits)
+Q_PROPERTY(int archiveAfterDays READ archiveAfterDays WRITE setArchiveAfterDays)
+Q_PROPERTY(int maximumIconCount READ maximumIconCount WRITE setMaximumIconCount)
+Q_PROPERTY(int currentDesktop READ currentDesktop NOTIFY currentPartitionChanged)
+Q_PROPERTY(QString currentKdeActivity READ currentKdeActivity NOTIFY currentPartitionChanged)
+Q_PROPERTY(QVariantMap statistics READ statistics NOTIFY statisticsChanged)
 public:
 
     explicit ActivityModel(QObject *parent = 0);
+    // Takes over the given backend instead of picking one for the session
+    explicit ActivityModel(FocusBackend *focusBackend, QObject *parent = 0);
     virtual ~ActivityModel();
 
     enum ItemRole {
         ActivityIconRole = Qt::UserRole + 1,
         ActivityNameRole,
         ActivityTimeRole,
-        ActivityPercentualUsage
+        ActivityPercentualUsage,
+        ActivityCategoryRole,
+        ActivitySecondsRole
     };
 
     int rowCount(const QModelIndex &parent) const Q_DECL_OVERRIDE;
@@ -100,28 +128,92 @@ public:
     bool timeTrackingEnabled() const;
     void setTimeTrackingEnabled(bool enabled);
 
+    // How long the last flush before suspend or shutdown took, -1 if there wasn't any yet
+    int lastFlushLatency() const;
+
     void setResetOnSuspend(bool reset);
     void setResetOnShutdown(bool reset);
 
+    QStringList activityRules() const;
+    void setActivityRules(const QStringList &rules);
+
+    QStringList usageLimits() const;
+    void setUsageLimits(const QStringList &limits);
+
+    // Activities not used for this many days are unloaded, 0 keeps them forever
+    int archiveAfterDays() const;
+    void setArchiveAfterDays(int days);
+
+    // Only icons of this many most recently used activities are kept, 0 keeps all
+    int maximumIconCount() const;
+    void setMaximumIconCount(int count);
+
+    // Time is also counted per partition, i.e. per virtual desktop and KDE activity
+    int currentDesktop() const;
+    QString currentKdeActivity() const;
+
+    // Time of the given row or of all rows within the partitions matching the
+    // given desktop and KDE activity, where 0 and an empty id match any of them
+    qint64 partitionSeconds(int row, int desktop, const QString &kdeActivity) const;
+    qint64 partitionTotalSeconds(int desktop, const QString &kdeActivity) const;
+
+    // Empty unless built with TIMEKEEPER_STATISTICS, changes with every tick
+    QVariantMap statistics() const;
+
 public Q_SLOTS:
     void ignoreActivity(const QString &activityName);
     void inhibit();
     void uninhibit();
     void resetTimeStatistics();
+    // Logs the statistics, also callable over D-Bus when built with TIMEKEEPER_STATISTICS
+    Q_SCRIPTABLE void dumpStatistics();
 
 private Q_SLOTS:
     void activeWindowChanged(WId window);
+    void windowResolved(WId window);
+    void iconResolved(WId window);
+    void limitReached(const QString &name, int minutes);
     void lockscreenActivityChanged(bool active);
     void prepareForSleepChanged(bool sleep);
     void prepareForShutdownChanged(bool shutdown);
     void updateCurrentActivityTime();
     void updateTrackingState();
+    void archiveUnusedActivities();
+    // Writes queued intervals up to the first one held back by a window waiting for its class
+    void writeHistory();
+    void currentDesktopChanged(int desktop);
+    void currentKdeActivityChanged(const QString &kdeActivity);
 
 Q_SIGNALS:
-    void currentActivityChanged();
+    void currentActivityIconChanged();
+    void currentActivityNameChanged();
+    void currentActivityTimeChanged();
+    void totalActivityTimeChanged();
+    void lastFlushLatencyChanged();
+    // Also when activities are ignored from the applet, the rules have to be stored then
+    void activityRulesChanged();
+    void currentPartitionChanged();
+    void statisticsChanged();
+    void usageLimitReached(const QString &name, int minutes);
     void timeTrackingEnabledChanged(bool enabled);
 
 private:
+    void accountActivityTime(const QTime &until);
+    // Seconds already counted for the partitions left since the last tick are given as switchedSecs
+    void creditActivityTime(ActivityModelItem *item, int secs, const QDateTime &end, quint32 partition, int switchedSecs = 0);
+    void closePendingInterval(const QTime &until);
+    ActivityModelItem *activityItem(WId window);
+    void flushAndUninhibit(bool reset);
+    void setCurrentActivity(WId window, const QTime &since);
+    void setCurrentItem(ActivityModelItem *item);
+    void removeItem(ActivityModelItem *item);
+    void touchIcon(ActivityModelItem *item);
+    void evictIcons();
+    void setCurrentPartition(int desktop, const QString &kdeActivity);
+    void recoverCheckpoint();
+    void restoreLimitUsage();
+    void updateFormattedTimes();
+
     class Private;
     Private *const d;
 };
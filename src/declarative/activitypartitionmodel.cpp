@@ -0,0 +1,225 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitypartitionmodel.h"
+#include "durationformat.h"
+
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+
+/*                     ActivityPartitionModel::Private                     *
+ * ----------------------------------------------------------------------- */
+class ActivityPartitionModel::Private
+{
+public:
+    Private()
+        : desktop(0)
+    { }
+
+    QPointer<ActivityModel> activityModel;
+    int desktop;
+    QString kdeActivity;
+
+    // Partition times and percentual usage last announced, per activity name.
+    // Changes of the source are collected until the event loop runs again.
+    QHash<QString, QPair<qint64, int> > shownValues;
+    QTimer updateTimer;
+};
+
+/*                       ActivityPartitionModel                            *
+ * ----------------------------------------------------------------------- */
+
+ActivityPartitionModel::ActivityPartitionModel(QObject *parent)
+    : QSortFilterProxyModel(parent),
+      d(new Private())
+{
+    d->updateTimer.setSingleShot(true);
+    d->updateTimer.setInterval(0);
+    connect(&d->updateTimer, &QTimer::timeout, this, &ActivityPartitionModel::updateChangedRows);
+}
+
+ActivityPartitionModel::~ActivityPartitionModel()
+{
+    delete d;
+}
+
+void ActivityPartitionModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (this->sourceModel()) {
+        disconnect(this->sourceModel(), 0, this, 0);
+    }
+
+    d->activityModel = qobject_cast<ActivityModel*>(sourceModel);
+
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+    d->shownValues.clear();
+
+    if (sourceModel) {
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, &ActivityPartitionModel::sourceDataChanged);
+    }
+}
+
+QVariant ActivityPartitionModel::data(const QModelIndex &index, int role) const
+{
+    if (!isPartitioned() || !index.isValid()) {
+        return QSortFilterProxyModel::data(index, role);
+    }
+
+    const int sourceRow = mapToSource(index).row();
+
+    switch (role) {
+        case ActivityModel::ActivityTimeRole:
+            return formatDuration(d->activityModel->partitionSeconds(sourceRow, d->desktop, d->kdeActivity));
+        case ActivityModel::ActivitySecondsRole:
+            return d->activityModel->partitionSeconds(sourceRow, d->desktop, d->kdeActivity);
+        case ActivityModel::ActivityPercentualUsage: {
+            const qint64 totalSeconds = d->activityModel->partitionTotalSeconds(d->desktop, d->kdeActivity);
+            const qint64 seconds = d->activityModel->partitionSeconds(sourceRow, d->desktop, d->kdeActivity);
+            return totalSeconds > 0 ? int(seconds * 100 / totalSeconds) : 0;
+        }
+        default:
+            return QSortFilterProxyModel::data(index, role);
+    }
+}
+
+int ActivityPartitionModel::desktop() const
+{
+    return d->desktop;
+}
+
+void ActivityPartitionModel::setDesktop(int desktop)
+{
+    if (d->desktop == desktop) {
+        return;
+    }
+
+    d->desktop = desktop;
+    Q_EMIT desktopChanged();
+
+    partitionChanged();
+}
+
+QString ActivityPartitionModel::kdeActivity() const
+{
+    return d->kdeActivity;
+}
+
+void ActivityPartitionModel::setKdeActivity(const QString &kdeActivity)
+{
+    if (d->kdeActivity == kdeActivity) {
+        return;
+    }
+
+    d->kdeActivity = kdeActivity;
+    Q_EMIT kdeActivityChanged();
+
+    partitionChanged();
+}
+
+bool ActivityPartitionModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
+{
+    Q_UNUSED(source_parent);
+
+    if (!isPartitioned()) {
+        return true;
+    }
+
+    return d->activityModel->partitionSeconds(source_row, d->desktop, d->kdeActivity) > 0;
+}
+
+void ActivityPartitionModel::sourceDataChanged()
+{
+    // A tick changes many rows one by one, they are compared only once afterwards
+    if (isPartitioned()) {
+        d->updateTimer.start();
+    }
+}
+
+void ActivityPartitionModel::updateChangedRows()
+{
+    if (!isPartitioned()) {
+        return;
+    }
+
+    // Time of one activity changes the percentual usage of all the others in
+    // the partition, but mostly they stay the same after rounding
+    const QVector<int> rows = changedRows();
+    const QVector<int> roles = QVector<int>() << ActivityModel::ActivityTimeRole
+                                              << ActivityModel::ActivitySecondsRole
+                                              << ActivityModel::ActivityPercentualUsage;
+
+    for (int i = 0; i < rows.count(); ) {
+        int last = i;
+        while (last + 1 < rows.count() && rows.at(last + 1) == rows.at(last) + 1) {
+            last++;
+        }
+
+        Q_EMIT dataChanged(index(rows.at(i), 0), index(rows.at(last), 0), roles);
+        i = last + 1;
+    }
+}
+
+QVector<int> ActivityPartitionModel::changedRows()
+{
+    QVector<int> rows;
+    QHash<QString, QPair<qint64, int> > values;
+
+    const qint64 totalSeconds = d->activityModel->partitionTotalSeconds(d->desktop, d->kdeActivity);
+
+    for (int row = 0; row < rowCount(); row++) {
+        const int sourceRow = mapToSource(index(row, 0)).row();
+        const QString name = sourceModel()->index(sourceRow, 0).data(ActivityModel::ActivityNameRole).toString();
+        const qint64 seconds = d->activityModel->partitionSeconds(sourceRow, d->desktop, d->kdeActivity);
+        const QPair<qint64, int> value(seconds, totalSeconds > 0 ? int(seconds * 100 / totalSeconds) : 0);
+
+        auto it = d->shownValues.constFind(name);
+        if (it == d->shownValues.constEnd() || *it != value) {
+            rows << row;
+        }
+        values.insert(name, value);
+    }
+
+    // Activities gone from the partition are forgotten
+    d->shownValues.swap(values);
+
+    return rows;
+}
+
+bool ActivityPartitionModel::isPartitioned() const
+{
+    return d->activityModel && (d->desktop > 0 || !d->kdeActivity.isEmpty());
+}
+
+void ActivityPartitionModel::partitionChanged()
+{
+    invalidateFilter();
+
+    d->updateTimer.stop();
+    d->shownValues.clear();
+    if (isPartitioned()) {
+        changedRows();
+    }
+
+    // Rows which stayed have different times now
+    if (rowCount() > 0) {
+        Q_EMIT dataChanged(index(0, 0), index(rowCount() - 1, 0));
+    }
+}
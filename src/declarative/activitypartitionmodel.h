@@ -0,0 +1,74 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_PARTITION_MODEL_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_PARTITION_MODEL_H
+
+#include <QSortFilterProxyModel>
+
+#include "activitymodel.h"
+
+// Limits an activity model to the time spent on one virtual desktop and/or
+// KDE activity. Times and percentual usage are replaced with the ones of the
+// partition and activities not used there are filtered out. With neither
+// desktop nor KDE activity set all rows are passed through unchanged.
+class Q_DECL_EXPORT ActivityPartitionModel : public QSortFilterProxyModel
+{
+Q_OBJECT
+Q_PROPERTY(QAbstractItemModel * sourceModel READ sourceModel WRITE setSourceModel)
+Q_PROPERTY(int desktop READ desktop WRITE setDesktop NOTIFY desktopChanged)
+Q_PROPERTY(QString kdeActivity READ kdeActivity WRITE setKdeActivity NOTIFY kdeActivityChanged)
+public:
+    explicit ActivityPartitionModel(QObject *parent = 0);
+    virtual ~ActivityPartitionModel();
+
+    void setSourceModel(QAbstractItemModel *sourceModel) Q_DECL_OVERRIDE;
+
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE;
+
+    // 0 matches all desktops
+    int desktop() const;
+    void setDesktop(int desktop);
+
+    // Empty matches all KDE activities
+    QString kdeActivity() const;
+    void setKdeActivity(const QString &kdeActivity);
+
+Q_SIGNALS:
+    void desktopChanged();
+    void kdeActivityChanged();
+
+protected:
+    bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void sourceDataChanged();
+    void updateChangedRows();
+
+private:
+    bool isPartitioned() const;
+    void partitionChanged();
+    QVector<int> changedRows();
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_PARTITION_MODEL_H
@@ -19,13 +19,190 @@
 */
 
 #include "activitysortmodel.h"
+#include "durationformat.h"
 
 #include <KLocalizedString>
 
+#include <QHash>
+#include <QMetaObject>
+#include <QSet>
+#include <QVector>
+
+#include <set>
+
 const static QString OTHER_APPLICATIONS_NAME = i18n("other applications");
 
+/*                     ActivitySortModel::Private                          *
+ * ----------------------------------------------------------------------- */
+class ActivitySortModel::Private
+{
+public:
+    Private()
+        : maximumCount(0),
+          minimumSeconds(0),
+          restCount(0),
+          restSeconds(0),
+          rankingChangedPending(false),
+          invalidatePending(false)
+    { }
+
+    enum Bucket {
+        ShownBucket,
+        RankedOutBucket,
+        TooShortBucket
+    };
+
+    struct Entry {
+        qint64 seconds;
+        Bucket bucket;
+    };
+
+    typedef std::pair<qint64, QString> Key;
+
+    // Most used activities first
+    struct KeyGreater {
+        bool operator()(const Key &left, const Key &right) const
+        {
+            if (left.first != right.first) {
+                return left.first > right.first;
+            }
+            return left.second < right.second;
+        }
+    };
+
+    void clear();
+    void insert(const QString &name, qint64 seconds);
+    void remove(const QString &name);
+    void setBucket(const QString &name, Bucket bucket);
+
+    int maximumCount;
+    int minimumSeconds;
+
+    // The shown activities and the best of the ranked out ones are kept ordered,
+    // so a change of one activity only needs to look at the boundary between them
+    std::set<Key, KeyGreater> shown;
+    std::set<Key, KeyGreater> rankedOut;
+    QHash<QString, Entry> entries;
+
+    // Name each source row is ranked under, activities can be renamed
+    QVector<QString> rowNames;
+
+    int restCount;
+    qint64 restSeconds;
+
+    // Activities other than the one being updated which were moved over the boundary
+    QSet<QString> movedActivities;
+
+    bool rankingChangedPending;
+    bool invalidatePending;
+};
+
+void ActivitySortModel::Private::clear()
+{
+    shown.clear();
+    rankedOut.clear();
+    entries.clear();
+    rowNames.clear();
+    movedActivities.clear();
+    restCount = 0;
+    restSeconds = 0;
+}
+
+void ActivitySortModel::Private::setBucket(const QString &name, Bucket bucket)
+{
+    Entry &entry = entries[name];
+    const bool wasRest = entry.bucket != ShownBucket;
+    const bool isRest = bucket != ShownBucket;
+
+    if (wasRest && !isRest) {
+        restCount--;
+        restSeconds -= entry.seconds;
+    } else if (!wasRest && isRest) {
+        restCount++;
+        restSeconds += entry.seconds;
+    }
+
+    if (wasRest != isRest) {
+        // Moving the same activity back and forth is not a change
+        if (movedActivities.contains(name)) {
+            movedActivities.remove(name);
+        } else {
+            movedActivities.insert(name);
+        }
+    }
+
+    entry.bucket = bucket;
+}
+
+void ActivitySortModel::Private::insert(const QString &name, qint64 seconds)
+{
+    Entry entry;
+    entry.seconds = seconds;
+    entry.bucket = TooShortBucket;
+    entries.insert(name, entry);
+    restCount++;
+    restSeconds += seconds;
+
+    if (seconds < minimumSeconds) {
+        return;
+    }
+
+    const Key key(seconds, name);
+
+    if (maximumCount <= 0 || int(shown.size()) < maximumCount) {
+        shown.insert(key);
+        setBucket(name, ShownBucket);
+        return;
+    }
+
+    const Key smallest = *shown.rbegin();
+    if (KeyGreater()(key, smallest)) {
+        shown.erase(smallest);
+        rankedOut.insert(smallest);
+        setBucket(smallest.second, RankedOutBucket);
+
+        shown.insert(key);
+        setBucket(name, ShownBucket);
+    } else {
+        rankedOut.insert(key);
+        setBucket(name, RankedOutBucket);
+    }
+}
+
+void ActivitySortModel::Private::remove(const QString &name)
+{
+    auto it = entries.constFind(name);
+    if (it == entries.constEnd()) {
+        return;
+    }
+
+    const Key key(it->seconds, name);
+
+    if (it->bucket == ShownBucket) {
+        shown.erase(key);
+
+        // Fill the freed place with the best ranked out activity
+        if (!rankedOut.empty()) {
+            const Key best = *rankedOut.begin();
+            rankedOut.erase(rankedOut.begin());
+            shown.insert(best);
+            setBucket(best.second, ShownBucket);
+        }
+    } else {
+        rankedOut.erase(key);
+        restCount--;
+        restSeconds -= it->seconds;
+    }
+
+    entries.remove(name);
+}
+
+/*                          ActivitySortModel                              *
+ * ----------------------------------------------------------------------- */
+
 ActivitySortModel::ActivitySortModel(QObject *parent)
-    : QSortFilterProxyModel(parent)
+    : QSortFilterProxyModel(parent),
+      d(new Private())
 {
     setDynamicSortFilter(true);
     sort(0, Qt::DescendingOrder);
@@ -33,20 +210,95 @@ ActivitySortModel::ActivitySortModel(QObject *parent)
 
 ActivitySortModel::~ActivitySortModel()
 {
+    delete d;
+}
+
+void ActivitySortModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (this->sourceModel()) {
+        disconnect(this->sourceModel(), 0, this, 0);
+    }
+
+    d->clear();
+
+    // Connected before the proxy model connects itself, so the ranking is up to
+    // date whenever it filters rows
+    if (sourceModel) {
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, &ActivitySortModel::sourceDataChanged);
+        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, &ActivitySortModel::sourceRowsInserted);
+        connect(sourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, &ActivitySortModel::sourceRowsAboutToBeRemoved);
+        connect(sourceModel, &QAbstractItemModel::modelReset, this, &ActivitySortModel::sourceModelReset);
+        connect(sourceModel, &QAbstractItemModel::layoutChanged, this, &ActivitySortModel::sourceModelReset);
+    }
+
+    QSortFilterProxyModel::setSourceModel(sourceModel);
+    sourceModelReset();
+
+    Q_EMIT restChanged();
+}
+
+int ActivitySortModel::maximumCount() const
+{
+    return d->maximumCount;
+}
+
+void ActivitySortModel::setMaximumCount(int count)
+{
+    if (d->maximumCount == count) {
+        return;
+    }
+
+    d->maximumCount = count;
+    rebuildRanking();
+    Q_EMIT maximumCountChanged();
+}
+
+int ActivitySortModel::minimumSeconds() const
+{
+    return d->minimumSeconds;
+}
+
+void ActivitySortModel::setMinimumSeconds(int seconds)
+{
+    if (d->minimumSeconds == seconds) {
+        return;
+    }
+
+    d->minimumSeconds = seconds;
+    rebuildRanking();
+    Q_EMIT minimumSecondsChanged();
+}
+
+int ActivitySortModel::restCount() const
+{
+    return d->restCount;
+}
+
+QString ActivitySortModel::restTime() const
+{
+    return formatDuration(d->restSeconds);
 }
 
 bool ActivitySortModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
 {
-    // TODO maybe
-    return QSortFilterProxyModel::filterAcceptsRow(source_row, source_parent);
+    const QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
+    const QString name = sourceModel()->data(index, ActivityModel::ActivityNameRole).toString();
+
+    // Already a group of activities on its own
+    if (name == OTHER_APPLICATIONS_NAME) {
+        return true;
+    }
+
+    auto it = d->entries.constFind(name);
+    return it != d->entries.constEnd() && it->bucket == Private::ShownBucket;
 }
 
 bool ActivitySortModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
 {
     const QString leftName = sourceModel()->data(left, ActivityModel::ActivityNameRole).toString();
     const QString rightName = sourceModel()->data(right, ActivityModel::ActivityNameRole).toString();
-    const QTime leftTime = sourceModel()->data(left, ActivityModel::ActivityTimeRole).toTime();
-    const QTime rightTime = sourceModel()->data(right, ActivityModel::ActivityTimeRole).toTime();
+    const qint64 leftSeconds = sourceModel()->data(left, ActivityModel::ActivitySecondsRole).toLongLong();
+    const qint64 rightSeconds = sourceModel()->data(right, ActivityModel::ActivitySecondsRole).toLongLong();
 
     if (leftName == OTHER_APPLICATIONS_NAME) {
         return true;
@@ -54,5 +306,139 @@ bool ActivitySortModel::lessThan(const QModelIndex &left, const QModelIndex &rig
         return false;
     }
 
-    return leftTime < rightTime;
+    return leftSeconds < rightSeconds;
+}
+
+void ActivitySortModel::rankRow(int row)
+{
+    const QModelIndex index = sourceModel()->index(row, 0);
+    const QString name = sourceModel()->data(index, ActivityModel::ActivityNameRole).toString();
+    const qint64 seconds = sourceModel()->data(index, ActivityModel::ActivitySecondsRole).toLongLong();
+
+    // Renamed, e.g. merged into the other applications
+    const QString previousName = d->rowNames.at(row);
+    if (previousName != name) {
+        d->remove(previousName);
+        d->rowNames[row] = name;
+    }
+
+    if (name == OTHER_APPLICATIONS_NAME) {
+        return;
+    }
+
+    auto it = d->entries.constFind(name);
+    if (it != d->entries.constEnd() && it->seconds == seconds) {
+        return;
+    }
+
+    d->remove(name);
+    d->insert(name, seconds);
+
+    // The proxy model filters the changed row itself, anything else moved over
+    // the boundary needs a new filtering pass
+    d->movedActivities.remove(name);
+}
+
+void ActivitySortModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    if (!roles.isEmpty() && !roles.contains(ActivityModel::ActivitySecondsRole) && !roles.contains(ActivityModel::ActivityNameRole)) {
+        return;
+    }
+
+    const int previousRestCount = d->restCount;
+    const qint64 previousRestSeconds = d->restSeconds;
+
+    for (int row = topLeft.row(); row <= bottomRight.row() && row < d->rowNames.count(); row++) {
+        rankRow(row);
+    }
+
+    if (!d->movedActivities.isEmpty()) {
+        d->movedActivities.clear();
+        d->invalidatePending = true;
+    }
+
+    if (d->invalidatePending || d->restCount != previousRestCount || d->restSeconds != previousRestSeconds) {
+        scheduleRankingChanged();
+    }
+}
+
+void ActivitySortModel::sourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    for (int row = first; row <= last; row++) {
+        d->rowNames.insert(row, QString());
+        rankRow(row);
+    }
+
+    if (!d->movedActivities.isEmpty()) {
+        d->movedActivities.clear();
+        d->invalidatePending = true;
+    }
+
+    scheduleRankingChanged();
+}
+
+void ActivitySortModel::sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid()) {
+        return;
+    }
+
+    for (int row = qMin(last, d->rowNames.count() - 1); row >= first; row--) {
+        d->remove(d->rowNames.at(row));
+        d->rowNames.remove(row);
+    }
+
+    if (!d->movedActivities.isEmpty()) {
+        d->movedActivities.clear();
+        d->invalidatePending = true;
+    }
+
+    scheduleRankingChanged();
+}
+
+void ActivitySortModel::sourceModelReset()
+{
+    d->clear();
+    d->invalidatePending = false;
+
+    const int count = sourceModel() ? sourceModel()->rowCount() : 0;
+    d->rowNames.resize(count);
+    for (int row = 0; row < count; row++) {
+        rankRow(row);
+    }
+    d->movedActivities.clear();
+}
+
+void ActivitySortModel::rebuildRanking()
+{
+    sourceModelReset();
+    invalidateFilter();
+
+    Q_EMIT restChanged();
+}
+
+void ActivitySortModel::rankingChanged()
+{
+    d->rankingChangedPending = false;
+
+    if (d->invalidatePending) {
+        d->invalidatePending = false;
+        invalidateFilter();
+    }
+
+    Q_EMIT restChanged();
+}
+
+void ActivitySortModel::scheduleRankingChanged()
+{
+    if (d->rankingChangedPending) {
+        return;
+    }
+
+    d->rankingChangedPending = true;
+    QMetaObject::invokeMethod(this, "rankingChanged", Qt::QueuedConnection);
 }
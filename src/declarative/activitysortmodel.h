@@ -29,13 +29,50 @@ class Q_DECL_EXPORT ActivitySortModel : public QSortFilterProxyModel
 {
 Q_OBJECT
 Q_PROPERTY(QAbstractItemModel * sourceModel READ sourceModel WRITE setSourceModel)
+Q_PROPERTY(int maximumCount READ maximumCount WRITE setMaximumCount NOTIFY maximumCountChanged)
+Q_PROPERTY(int minimumSeconds READ minimumSeconds WRITE setMinimumSeconds NOTIFY minimumSecondsChanged)
+Q_PROPERTY(int restCount READ restCount NOTIFY restChanged)
+Q_PROPERTY(QString restTime READ restTime NOTIFY restChanged)
 public:
     explicit ActivitySortModel(QObject *parent = 0);
     virtual ~ActivitySortModel();
 
+    void setSourceModel(QAbstractItemModel *sourceModel) Q_DECL_OVERRIDE;
+
+    // Only the given number of activities with the most time is shown, 0 shows all of them
+    int maximumCount() const;
+    void setMaximumCount(int count);
+
+    int minimumSeconds() const;
+    void setMinimumSeconds(int seconds);
+
+    // Activities hidden by the filters above
+    int restCount() const;
+    QString restTime() const;
+
+Q_SIGNALS:
+    void maximumCountChanged();
+    void minimumSecondsChanged();
+    void restChanged();
+
 protected:
     bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const Q_DECL_OVERRIDE;
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void sourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void sourceModelReset();
+    void rebuildRanking();
+    void rankingChanged();
+
+private:
+    void rankRow(int row);
+    void scheduleRankingChanged();
+
+    class Private;
+    Private *const d;
 };
 
 
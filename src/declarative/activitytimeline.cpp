@@ -0,0 +1,141 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitytimeline.h"
+
+#include <QPointer>
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+
+/*                     ActivityTimeline::Private                           *
+ * ----------------------------------------------------------------------- */
+class ActivityTimeline::Private
+{
+public:
+    QPointer<ActivityTimelineModel> model;
+};
+
+/*                          ActivityTimeline                               *
+ * ----------------------------------------------------------------------- */
+
+ActivityTimeline::ActivityTimeline(QQuickItem *parent)
+    : QQuickItem(parent),
+      d(new Private())
+{
+    setFlag(ItemHasContents, true);
+}
+
+ActivityTimeline::~ActivityTimeline()
+{
+    delete d;
+}
+
+ActivityTimelineModel *ActivityTimeline::model() const
+{
+    return d->model;
+}
+
+void ActivityTimeline::setModel(ActivityTimelineModel *model)
+{
+    if (d->model == model) {
+        return;
+    }
+
+    if (d->model) {
+        disconnect(d->model, 0, this, 0);
+    }
+
+    d->model = model;
+
+    if (d->model) {
+        connect(d->model, &ActivityTimelineModel::segmentsChanged, this, &QQuickItem::update);
+    }
+
+    Q_EMIT modelChanged();
+    update();
+}
+
+void ActivityTimeline::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+    update();
+}
+
+QSGNode *ActivityTimeline::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    Q_UNUSED(data);
+
+    QSGGeometryNode *node = static_cast<QSGGeometryNode*>(oldNode);
+
+    const qint64 from = d->model ? d->model->from().toMSecsSinceEpoch() : 0;
+    const qint64 to = d->model ? d->model->to().toMSecsSinceEpoch() : 0;
+
+    if (!d->model || d->model->segments().isEmpty() || to <= from || width() <= 0 || height() <= 0) {
+        delete node;
+        return 0;
+    }
+
+    if (!node) {
+        QSGGeometry *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+        geometry->setDrawingMode(GL_TRIANGLES);
+
+        node = new QSGGeometryNode();
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGVertexColorMaterial());
+        node->setFlag(QSGNode::OwnsMaterial);
+    }
+
+    const QVector<ActivityTimelineModel::Segment> &segments = d->model->segments();
+
+    // Two triangles per segment
+    QSGGeometry *geometry = node->geometry();
+    geometry->allocate(segments.count() * 6);
+    QSGGeometry::ColoredPoint2D *vertices = geometry->vertexDataAsColoredPoint2D();
+
+    const double scale = width() / double(to - from);
+    const float laneHeight = height() / d->model->laneCount();
+
+    foreach (const ActivityTimelineModel::Segment &segment, segments) {
+        const QColor color = d->model->laneColor(segment.lane);
+        const uchar red = color.red();
+        const uchar green = color.green();
+        const uchar blue = color.blue();
+        const uchar alpha = color.alpha();
+
+        // Segments merged down to less than a pixel are still shown
+        const float left = (segment.start - from) * scale;
+        const float right = qMax<float>((segment.end - from) * scale, left + 1);
+        const float top = segment.lane * laneHeight;
+        const float bottom = top + qMax<float>(laneHeight - 1, 1);
+
+        vertices[0].set(left, top, red, green, blue, alpha);
+        vertices[1].set(right, top, red, green, blue, alpha);
+        vertices[2].set(left, bottom, red, green, blue, alpha);
+        vertices[3].set(right, top, red, green, blue, alpha);
+        vertices[4].set(right, bottom, red, green, blue, alpha);
+        vertices[5].set(left, bottom, red, green, blue, alpha);
+        vertices += 6;
+    }
+
+    node->markDirty(QSGNode::DirtyGeometry);
+
+    return node;
+}
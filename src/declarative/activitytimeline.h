@@ -0,0 +1,57 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_TIMELINE_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_TIMELINE_H
+
+#include <QQuickItem>
+
+#include "activitytimelinemodel.h"
+
+/*                          ActivityTimeline                               *
+ * ----------------------------------------------------------------------- */
+
+// Draws the segments of a timeline model as colored bars, one lane per
+// activity. All bars are one geometry node with per-vertex colors, so the
+// whole timeline is a single draw call however many segments there are.
+class Q_DECL_EXPORT ActivityTimeline : public QQuickItem
+{
+Q_OBJECT
+Q_PROPERTY(ActivityTimelineModel * model READ model WRITE setModel NOTIFY modelChanged)
+public:
+    explicit ActivityTimeline(QQuickItem *parent = 0);
+    virtual ~ActivityTimeline();
+
+    ActivityTimelineModel *model() const;
+    void setModel(ActivityTimelineModel *model);
+
+Q_SIGNALS:
+    void modelChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) Q_DECL_OVERRIDE;
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) Q_DECL_OVERRIDE;
+
+private:
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_TIMELINE_H
@@ -0,0 +1,551 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitytimelinemodel.h"
+#include "activityhistory.h"
+
+#include <KLocalizedString>
+
+#include <QHash>
+#include <QTimer>
+
+#include <algorithm>
+#include <limits>
+
+// Hue of an activity, the same in every session unlike qHash() which is seeded
+// per process. FNV-1a over the UTF-8 name.
+static int activityHue(const QString &name)
+{
+    const QByteArray utf8 = name.toUtf8();
+
+    quint32 hash = 2166136261u;
+    foreach (char c, utf8) {
+        hash ^= uchar(c);
+        hash *= 16777619u;
+    }
+
+    return hash % 360;
+}
+
+/*                     ActivityTimelineModel::Private                      *
+ * ----------------------------------------------------------------------- */
+class ActivityTimelineModel::Private
+{
+public:
+    Private()
+        : history(0),
+          pixelWidth(0),
+          maximumLanes(6),
+          active(true),
+          rebuildPending(true),
+          built(false),
+          builtFrom(0),
+          builtTo(0),
+          msecsPerPixel(1),
+          builtCount(0),
+          shared(false),
+          sharedLane(0)
+    { }
+
+    ~Private()
+    {
+        delete history;
+    }
+
+    ActivityHistory *history;
+    QString historyPath;
+
+    QDateTime from;
+    QDateTime to;
+    int pixelWidth;
+    int maximumLanes;
+    bool active;
+
+    QVector<Segment> segments;
+
+    // Activity and color of every lane
+    QStringList laneActivities;
+    QVector<QColor> laneColors;
+
+    // Coalesces changes of the range and width done together
+    QTimer updateTimer;
+
+    // Looks for intervals appended to the history while active
+    QTimer historyTimer;
+
+    // Anything but appended intervals changed, the segments are built anew
+    bool rebuildPending;
+
+    // State of the last build, intervals appended to the history since are
+    // added to it without resetting the model
+    bool built;
+    qint64 builtFrom;
+    qint64 builtTo;
+    qint64 msecsPerPixel;
+    qint64 builtCount;
+    QHash<quint32, qint64> visibleMsecs;
+    QHash<quint32, int> lanes;
+    bool shared;
+    int sharedLane;
+    // Last segment of every lane, the one new intervals may get merged into
+    QVector<int> lastSegments;
+};
+
+/*                        ActivityTimelineModel                            *
+ * ----------------------------------------------------------------------- */
+
+ActivityTimelineModel::ActivityTimelineModel(QObject *parent)
+    : QAbstractListModel(parent),
+      d(new Private())
+{
+    d->historyPath = ActivityHistory::defaultPath();
+
+    d->updateTimer.setSingleShot(true);
+    d->updateTimer.setInterval(0);
+    connect(&d->updateTimer, &QTimer::timeout, this, &ActivityTimelineModel::updateSegments);
+
+    // The history gets new intervals once a minute at most
+    d->historyTimer.setTimerType(Qt::VeryCoarseTimer);
+    d->historyTimer.start(60000);
+    connect(&d->historyTimer, &QTimer::timeout, this, &ActivityTimelineModel::checkHistory);
+}
+
+ActivityTimelineModel::~ActivityTimelineModel()
+{
+    delete d;
+}
+
+QVariant ActivityTimelineModel::data(const QModelIndex &index, int role) const
+{
+    const int row = index.row();
+
+    if (row >= 0 && row < d->segments.count()) {
+        const Segment &segment = d->segments.at(row);
+
+        switch (role) {
+            case ActivityNameRole:
+                return d->laneActivities.at(segment.lane);
+                break;
+            case SegmentStartRole:
+                return QDateTime::fromMSecsSinceEpoch(segment.start);
+                break;
+            case SegmentEndRole:
+                return QDateTime::fromMSecsSinceEpoch(segment.end);
+                break;
+            case SegmentLaneRole:
+                return segment.lane;
+                break;
+            case SegmentColorRole:
+                return d->laneColors.at(segment.lane);
+                break;
+            default:
+                break;
+        }
+    }
+
+    return QVariant();
+}
+
+int ActivityTimelineModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return d->segments.count();
+}
+
+QHash< int, QByteArray > ActivityTimelineModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles[ActivityNameRole] = "ActivityName";
+    roles[SegmentStartRole] = "SegmentStart";
+    roles[SegmentEndRole] = "SegmentEnd";
+    roles[SegmentLaneRole] = "SegmentLane";
+    roles[SegmentColorRole] = "SegmentColor";
+
+    return roles;
+}
+
+QString ActivityTimelineModel::historyPath() const
+{
+    return d->historyPath;
+}
+
+void ActivityTimelineModel::setHistoryPath(const QString &path)
+{
+    if (d->historyPath == path) {
+        return;
+    }
+
+    d->historyPath = path;
+    reload();
+}
+
+QDateTime ActivityTimelineModel::from() const
+{
+    return d->from;
+}
+
+void ActivityTimelineModel::setFrom(const QDateTime &from)
+{
+    if (d->from == from) {
+        return;
+    }
+
+    d->from = from;
+    Q_EMIT rangeChanged();
+    scheduleUpdate();
+}
+
+QDateTime ActivityTimelineModel::to() const
+{
+    return d->to;
+}
+
+void ActivityTimelineModel::setTo(const QDateTime &to)
+{
+    if (d->to == to) {
+        return;
+    }
+
+    d->to = to;
+    Q_EMIT rangeChanged();
+    scheduleUpdate();
+}
+
+int ActivityTimelineModel::pixelWidth() const
+{
+    return d->pixelWidth;
+}
+
+void ActivityTimelineModel::setPixelWidth(int width)
+{
+    if (d->pixelWidth == width) {
+        return;
+    }
+
+    d->pixelWidth = width;
+    Q_EMIT pixelWidthChanged();
+    scheduleUpdate();
+}
+
+int ActivityTimelineModel::maximumLanes() const
+{
+    return d->maximumLanes;
+}
+
+void ActivityTimelineModel::setMaximumLanes(int lanes)
+{
+    if (d->maximumLanes == lanes) {
+        return;
+    }
+
+    d->maximumLanes = lanes;
+    Q_EMIT maximumLanesChanged();
+    scheduleUpdate();
+}
+
+bool ActivityTimelineModel::isActive() const
+{
+    return d->active;
+}
+
+void ActivityTimelineModel::setActive(bool active)
+{
+    if (d->active == active) {
+        return;
+    }
+
+    d->active = active;
+    Q_EMIT activeChanged();
+
+    // Whatever was recorded while hidden is shown right away
+    if (active) {
+        d->historyTimer.start();
+        checkHistory();
+    } else {
+        d->historyTimer.stop();
+    }
+}
+
+const QVector<ActivityTimelineModel::Segment> &ActivityTimelineModel::segments() const
+{
+    return d->segments;
+}
+
+int ActivityTimelineModel::laneCount() const
+{
+    return d->laneActivities.count();
+}
+
+QStringList ActivityTimelineModel::laneActivities() const
+{
+    return d->laneActivities;
+}
+
+QString ActivityTimelineModel::laneActivity(int lane) const
+{
+    return d->laneActivities.value(lane);
+}
+
+QColor ActivityTimelineModel::laneColor(int lane) const
+{
+    return d->laneColors.value(lane);
+}
+
+void ActivityTimelineModel::reload()
+{
+    delete d->history;
+    d->history = 0;
+
+    scheduleUpdate();
+}
+
+void ActivityTimelineModel::checkHistory()
+{
+    if (!d->history) {
+        scheduleUpdate();
+        return;
+    }
+
+    // Only the intervals appended since are read, and added to the segments
+    bool reopened = false;
+    if (!d->history->refresh(&reopened)) {
+        return;
+    }
+
+    if (reopened) {
+        d->rebuildPending = true;
+    }
+
+    if (!d->updateTimer.isActive()) {
+        d->updateTimer.start();
+    }
+}
+
+void ActivityTimelineModel::scheduleUpdate()
+{
+    d->rebuildPending = true;
+
+    if (!d->updateTimer.isActive()) {
+        d->updateTimer.start();
+    }
+}
+
+void ActivityTimelineModel::updateSegments()
+{
+    if (d->rebuildPending || !d->built || !appendSegments()) {
+        rebuildSegments();
+    }
+}
+
+void ActivityTimelineModel::rebuildSegments()
+{
+    beginResetModel();
+
+    d->segments.clear();
+    d->laneActivities.clear();
+    d->laneColors.clear();
+    d->visibleMsecs.clear();
+    d->lanes.clear();
+    d->lastSegments.clear();
+    d->rebuildPending = false;
+    d->built = false;
+
+    if (!d->history) {
+        d->history = new ActivityHistory(d->historyPath);
+        d->history->open();
+    }
+
+    const qint64 from = d->from.toMSecsSinceEpoch();
+    const qint64 to = d->to.toMSecsSinceEpoch();
+
+    if (d->history->isOpen() && d->from.isValid() && d->to.isValid() && from < to && d->pixelWidth > 0) {
+        // Intervals closer than this are indistinguishable, so they are merged
+        const qint64 msecsPerPixel = qMax<qint64>((to - from) / d->pixelWidth, 1);
+        d->msecsPerPixel = msecsPerPixel;
+        d->builtFrom = from;
+        d->builtTo = to;
+
+        const ActivityHistory::Interval *intervals = d->history->intervals();
+        const QStringList activities = d->history->activities();
+
+        // Long intervals starting before the others come first, so all are ordered by start
+        QVector<qint64> indexes;
+        const qint64 first = d->history->firstIntersecting(from, &indexes);
+        const qint64 last = d->history->lowerBound(to);
+        indexes.reserve(indexes.count() + int(qMax<qint64>(last - first, 0)));
+        for (qint64 i = first; i < last; i++) {
+            indexes << i;
+        }
+
+        QHash<quint32, qint64> &visibleMsecs = d->visibleMsecs;
+        foreach (qint64 index, indexes) {
+            const qint64 start = qMax(intervals[index].start, from);
+            const qint64 end = qMin(intervals[index].start + qint64(intervals[index].seconds) * 1000, to);
+            if (end > start) {
+                visibleMsecs[intervals[index].activity] += end - start;
+            }
+        }
+
+        // The most used activities get their own lane, the rest share the last one
+        QVector<quint32> visibleActivities = visibleMsecs.keys().toVector();
+        const bool shared = d->maximumLanes > 0 && visibleActivities.count() > d->maximumLanes;
+        if (shared) {
+            std::sort(visibleActivities.begin(), visibleActivities.end(), [&visibleMsecs] (quint32 left, quint32 right) {
+                return visibleMsecs.value(left) > visibleMsecs.value(right);
+            });
+            visibleActivities.resize(d->maximumLanes - 1);
+        }
+
+        // Lanes are ordered by activity to keep them stable while scrolling
+        std::sort(visibleActivities.begin(), visibleActivities.end());
+
+        QHash<quint32, int> &lanes = d->lanes;
+        foreach (quint32 activity, visibleActivities) {
+            const QString name = activities.value(activity);
+            lanes.insert(activity, d->laneActivities.count());
+            d->laneActivities << name;
+            d->laneColors << QColor::fromHsv(activityHue(name), 150, 210);
+        }
+
+        const int sharedLane = d->laneActivities.count();
+        if (shared) {
+            d->laneActivities << i18n("other applications");
+            d->laneColors << QColor::fromHsv(0, 0, 160);
+        }
+        d->shared = shared;
+        d->sharedLane = sharedLane;
+
+        QVector<int> &lastSegments = d->lastSegments;
+        lastSegments.fill(-1, d->laneActivities.count());
+
+        foreach (qint64 index, indexes) {
+            const qint64 start = qMax(intervals[index].start, from);
+            const qint64 end = qMin(intervals[index].start + qint64(intervals[index].seconds) * 1000, to);
+            if (end <= start) {
+                continue;
+            }
+
+            const int lane = lanes.value(intervals[index].activity, sharedLane);
+            const int lastSegment = lastSegments.at(lane);
+
+            if (lastSegment >= 0 && start - d->segments.at(lastSegment).end < msecsPerPixel) {
+                Segment &segment = d->segments[lastSegment];
+                segment.end = qMax(segment.end, end);
+                continue;
+            }
+
+            Segment segment;
+            segment.start = start;
+            segment.end = end;
+            segment.lane = lane;
+            lastSegments[lane] = d->segments.count();
+            d->segments << segment;
+        }
+
+        d->builtCount = d->history->count();
+        d->built = true;
+    }
+
+    endResetModel();
+
+    Q_EMIT segmentsChanged();
+}
+
+bool ActivityTimelineModel::appendSegments()
+{
+    const ActivityHistory::Interval *intervals = d->history->intervals();
+    const qint64 from = d->builtFrom;
+    const qint64 to = d->builtTo;
+
+    // Appended intervals start after all the others, so the ones within the range come first
+    const qint64 first = qMin(d->builtCount, d->history->count());
+    const qint64 last = qMax(d->history->lowerBound(to), first);
+
+    qint64 leastLaneMsecs = std::numeric_limits<qint64>::max();
+    if (d->shared) {
+        for (auto it = d->lanes.constBegin(); it != d->lanes.constEnd(); ++it) {
+            leastLaneMsecs = qMin(leastLaneMsecs, d->visibleMsecs.value(it.key()));
+        }
+    }
+
+    // An activity needing a lane of its own changes the lanes of the others
+    for (qint64 i = first; i < last; i++) {
+        const qint64 start = qMax(intervals[i].start, from);
+        const qint64 end = qMin(intervals[i].start + qint64(intervals[i].seconds) * 1000, to);
+        if (end <= start) {
+            continue;
+        }
+
+        const quint32 activity = intervals[i].activity;
+        const qint64 msecs = d->visibleMsecs.value(activity) + end - start;
+        d->visibleMsecs.insert(activity, msecs);
+
+        if (!d->lanes.contains(activity) && (!d->shared || msecs > leastLaneMsecs)) {
+            return false;
+        }
+    }
+
+    int firstChanged = -1;
+    int lastChanged = -1;
+    bool inserted = false;
+
+    for (qint64 i = first; i < last; i++) {
+        const qint64 start = qMax(intervals[i].start, from);
+        const qint64 end = qMin(intervals[i].start + qint64(intervals[i].seconds) * 1000, to);
+        if (end <= start) {
+            continue;
+        }
+
+        const int lane = d->lanes.value(intervals[i].activity, d->sharedLane);
+        const int lastSegment = d->lastSegments.at(lane);
+
+        if (lastSegment >= 0 && start - d->segments.at(lastSegment).end < d->msecsPerPixel) {
+            Segment &segment = d->segments[lastSegment];
+            segment.end = qMax(segment.end, end);
+            firstChanged = firstChanged < 0 ? lastSegment : qMin(firstChanged, lastSegment);
+            lastChanged = qMax(lastChanged, lastSegment);
+            continue;
+        }
+
+        Segment segment;
+        segment.start = start;
+        segment.end = end;
+        segment.lane = lane;
+
+        const int row = d->segments.count();
+        beginInsertRows(QModelIndex(), row, row);
+        d->lastSegments[lane] = row;
+        d->segments << segment;
+        endInsertRows();
+        inserted = true;
+    }
+
+    d->builtCount = d->history->count();
+
+    if (firstChanged >= 0) {
+        Q_EMIT dataChanged(index(firstChanged, 0), index(lastChanged, 0), QVector<int>() << SegmentEndRole);
+    }
+
+    if (firstChanged >= 0 || inserted) {
+        Q_EMIT segmentsChanged();
+    }
+
+    return true;
+}
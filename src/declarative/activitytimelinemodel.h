@@ -0,0 +1,125 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_ACTIVITY_TIMELINE_MODEL_H
+#define PLASMA_TIMEKEEPER_ACTIVITY_TIMELINE_MODEL_H
+
+#include <QAbstractListModel>
+#include <QColor>
+#include <QDateTime>
+#include <QStringList>
+#include <QVector>
+
+/*                        ActivityTimelineModel                            *
+ * ----------------------------------------------------------------------- */
+
+// When activities were used within a time range, read from the interval
+// history. Only intervals intersecting the range are looked at, found by a
+// binary search in the history. Intervals of one activity closer to each other
+// than one pixel at the given width are merged, so the number of segments is
+// bounded by the width no matter how busy the range is. Every activity gets
+// its own lane, up to maximumLanes, the least used ones share the last lane.
+// The history is only checked for new intervals while active.
+class Q_DECL_EXPORT ActivityTimelineModel : public QAbstractListModel
+{
+Q_OBJECT
+Q_PROPERTY(QString historyPath READ historyPath WRITE setHistoryPath)
+Q_PROPERTY(QDateTime from READ from WRITE setFrom NOTIFY rangeChanged)
+Q_PROPERTY(QDateTime to READ to WRITE setTo NOTIFY rangeChanged)
+Q_PROPERTY(int pixelWidth READ pixelWidth WRITE setPixelWidth NOTIFY pixelWidthChanged)
+Q_PROPERTY(int maximumLanes READ maximumLanes WRITE setMaximumLanes NOTIFY maximumLanesChanged)
+Q_PROPERTY(int laneCount READ laneCount NOTIFY segmentsChanged)
+Q_PROPERTY(QStringList laneActivities READ laneActivities NOTIFY segmentsChanged)
+Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+public:
+    explicit ActivityTimelineModel(QObject *parent = 0);
+    virtual ~ActivityTimelineModel();
+
+    enum ItemRole {
+        ActivityNameRole = Qt::UserRole + 1,
+        SegmentStartRole,
+        SegmentEndRole,
+        SegmentLaneRole,
+        SegmentColorRole
+    };
+
+    // Times in milliseconds since epoch
+    struct Segment {
+        qint64 start;
+        qint64 end;
+        int lane;
+    };
+
+    int rowCount(const QModelIndex &parent) const Q_DECL_OVERRIDE;
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE;
+    virtual QHash< int, QByteArray > roleNames() const Q_DECL_OVERRIDE;
+
+    QString historyPath() const;
+    void setHistoryPath(const QString &path);
+
+    QDateTime from() const;
+    void setFrom(const QDateTime &from);
+
+    QDateTime to() const;
+    void setTo(const QDateTime &to);
+
+    int pixelWidth() const;
+    void setPixelWidth(int width);
+
+    int maximumLanes() const;
+    void setMaximumLanes(int lanes);
+
+    bool isActive() const;
+    void setActive(bool active);
+
+    // For painting without going through the model roles
+    const QVector<Segment> &segments() const;
+    int laneCount() const;
+    QStringList laneActivities() const;
+    QString laneActivity(int lane) const;
+    QColor laneColor(int lane) const;
+
+public Q_SLOTS:
+    // Reads the whole history again
+    void reload();
+
+Q_SIGNALS:
+    void rangeChanged();
+    void pixelWidthChanged();
+    void maximumLanesChanged();
+    void activeChanged();
+    void segmentsChanged();
+
+private Q_SLOTS:
+    void updateSegments();
+    void checkHistory();
+
+private:
+    void scheduleUpdate();
+    void rebuildSegments();
+    // Adds the intervals appended to the history since the last build, false if
+    // they need lanes of their own and everything has to be built anew
+    bool appendSegments();
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_ACTIVITY_TIMELINE_MODEL_H
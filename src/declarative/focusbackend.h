@@ -0,0 +1,64 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_FOCUS_BACKEND_H
+#define PLASMA_TIMEKEEPER_FOCUS_BACKEND_H
+
+#include <QObject>
+#include <QPixmap>
+#include <QWindow>
+
+/*                            FocusBackend                                 *
+ * ----------------------------------------------------------------------- */
+
+// Tells which window has focus and which application it belongs to. Windows
+// are identified by ids only meaningful to the backend. Looking up a window
+// must never block, windows not known yet are resolved asynchronously and
+// announced with windowResolved(), their icons with iconResolved().
+class FocusBackend : public QObject
+{
+Q_OBJECT
+public:
+    // The Wayland backend on Plasma Wayland sessions if built with it, the X11 one otherwise
+    static FocusBackend *create(QObject *parent = 0);
+
+    virtual ~FocusBackend();
+
+    // 0 if there is no active window
+    virtual WId activeWindow() const = 0;
+
+    virtual bool isResolved(WId window) const = 0;
+    // Window class on X11, app id on Wayland
+    virtual QString windowClass(WId window) const = 0;
+    // Null if the icon is not there yet, it gets fetched then
+    virtual QPixmap windowIcon(WId window) = 0;
+
+    virtual void resolve(WId window) = 0;
+
+Q_SIGNALS:
+    void activeWindowChanged(WId window);
+    void windowResolved(WId window);
+    void iconResolved(WId window);
+
+protected:
+    explicit FocusBackend(QObject *parent = 0);
+};
+
+#endif // PLASMA_TIMEKEEPER_FOCUS_BACKEND_H
@@ -21,8 +21,12 @@
 #include <QtQml>
 
 #include "qmlplugins.h"
+#include "activitycategorymodel.h"
 #include "activitymodel.h"
+#include "activitypartitionmodel.h"
 #include "activitysortmodel.h"
+#include "activitytimeline.h"
+#include "activitytimelinemodel.h"
 
 void QmlPlugins::registerTypes(const char *uri)
 {
@@ -32,4 +36,12 @@ void QmlPlugins::registerTypes(const char *uri)
     qmlRegisterType<ActivityModel>(uri, 0, 2, "ActivityModel");
     // @uri org.kde.plasma.timekeeper.ActivitySortModel
     qmlRegisterType<ActivitySortModel>(uri, 0, 2, "ActivitySortModel");
+    // @uri org.kde.plasma.timekeeper.ActivityCategoryModel
+    qmlRegisterType<ActivityCategoryModel>(uri, 0, 2, "ActivityCategoryModel");
+    // @uri org.kde.plasma.timekeeper.ActivityPartitionModel
+    qmlRegisterType<ActivityPartitionModel>(uri, 0, 2, "ActivityPartitionModel");
+    // @uri org.kde.plasma.timekeeper.ActivityTimelineModel
+    qmlRegisterType<ActivityTimelineModel>(uri, 0, 2, "ActivityTimelineModel");
+    // @uri org.kde.plasma.timekeeper.ActivityTimeline
+    qmlRegisterType<ActivityTimeline>(uri, 0, 2, "ActivityTimeline");
 }
@@ -0,0 +1,53 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timekeeperclock.h"
+
+#include <QAtomicInteger>
+
+static QAtomicInteger<qint64> s_offset;
+
+/*                          TimekeeperClock                                *
+ * ----------------------------------------------------------------------- */
+
+QDateTime TimekeeperClock::currentDateTime()
+{
+    return QDateTime::currentDateTime().addMSecs(s_offset.load());
+}
+
+QDateTime TimekeeperClock::currentDateTimeUtc()
+{
+    return QDateTime::currentDateTimeUtc().addMSecs(s_offset.load());
+}
+
+QDate TimekeeperClock::currentDate()
+{
+    return currentDateTime().date();
+}
+
+QTime TimekeeperClock::currentTime()
+{
+    return currentDateTime().time();
+}
+
+void TimekeeperClock::advance(qint64 msecs)
+{
+    s_offset.fetchAndAddOrdered(qMax<qint64>(msecs, 0));
+}
@@ -0,0 +1,43 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_CLOCK_H
+#define PLASMA_TIMEKEEPER_CLOCK_H
+
+#include <QDateTime>
+
+/*                          TimekeeperClock                                *
+ * ----------------------------------------------------------------------- */
+
+// Wall clock the model counts time with. It is the system time unless a test
+// moves it forward to run through weeks of a session within seconds.
+class TimekeeperClock
+{
+public:
+    static QDateTime currentDateTime();
+    static QDateTime currentDateTimeUtc();
+    static QDate currentDate();
+    static QTime currentTime();
+
+    // Only meant for tests, there is no way back
+    static void advance(qint64 msecs);
+};
+
+#endif // PLASMA_TIMEKEEPER_CLOCK_H
@@ -0,0 +1,199 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timekeeperstatistics.h"
+
+#ifdef TIMEKEEPER_STATISTICS
+
+#include <QStringList>
+
+#include <cstring>
+
+static const char *PROBE_NAMES[] = {
+    "focusChange",
+    "tick",
+    "configFlush",
+    "sleepFlush"
+};
+
+static const char *COUNTER_NAMES[] = {
+    "configFlushBytes",
+    "modelSignals"
+};
+
+static const char *GAUGE_NAMES[] = {
+    "trackedItems",
+    "trackedItemsMemory"
+};
+
+/*                    TimekeeperStatistics::Private                        *
+ * ----------------------------------------------------------------------- */
+class TimekeeperStatistics::Private
+{
+public:
+    // Bucket N holds latencies from 2^N to 2^(N+1) microseconds
+    static const int BucketCount = 32;
+
+    struct Histogram {
+        quint64 count;
+        quint64 totalNsecs;
+        quint64 maxNsecs;
+        quint32 buckets[BucketCount];
+    };
+
+    Private()
+    {
+        memset(histograms, 0, sizeof(histograms));
+        memset(counters, 0, sizeof(counters));
+        memset(gauges, 0, sizeof(gauges));
+    }
+
+    static int bucket(qint64 nsecs);
+    static quint64 percentile(const Histogram &histogram, int percent);
+
+    Histogram histograms[ProbeCount];
+    qint64 counters[CounterCount];
+    qint64 gauges[GaugeCount];
+};
+
+int TimekeeperStatistics::Private::bucket(qint64 nsecs)
+{
+    quint64 usecs = nsecs / 1000;
+    int bucket = 0;
+    while (usecs > 1 && bucket < BucketCount - 1) {
+        usecs >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+quint64 TimekeeperStatistics::Private::percentile(const Histogram &histogram, int percent)
+{
+    if (!histogram.count) {
+        return 0;
+    }
+
+    // Upper bound of the bucket the percentile falls into, in microseconds
+    const quint64 wanted = (histogram.count * percent + 99) / 100;
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; i++) {
+        seen += histogram.buckets[i];
+        if (seen >= wanted) {
+            return quint64(1) << (i + 1);
+        }
+    }
+
+    return histogram.maxNsecs / 1000;
+}
+
+/*                        TimekeeperStatistics                             *
+ * ----------------------------------------------------------------------- */
+
+TimekeeperStatistics *TimekeeperStatistics::self()
+{
+    // Only touched from the GUI thread
+    static TimekeeperStatistics statistics;
+    return &statistics;
+}
+
+TimekeeperStatistics::TimekeeperStatistics()
+    : d(new Private())
+{
+}
+
+void TimekeeperStatistics::record(Probe probe, qint64 nsecs)
+{
+    Private::Histogram &histogram = d->histograms[probe];
+    histogram.count++;
+    histogram.totalNsecs += nsecs;
+    histogram.maxNsecs = qMax<quint64>(histogram.maxNsecs, nsecs);
+    histogram.buckets[Private::bucket(nsecs)]++;
+}
+
+void TimekeeperStatistics::add(Counter counter, qint64 value)
+{
+    d->counters[counter] += value;
+}
+
+void TimekeeperStatistics::set(Gauge gauge, qint64 value)
+{
+    d->gauges[gauge] = value;
+}
+
+QVariantMap TimekeeperStatistics::toVariantMap() const
+{
+    QVariantMap map;
+
+    for (int i = 0; i < ProbeCount; i++) {
+        const Private::Histogram &histogram = d->histograms[i];
+
+        QVariantList buckets;
+        for (int j = 0; j < Private::BucketCount; j++) {
+            buckets << histogram.buckets[j];
+        }
+
+        QVariantMap probe;
+        probe[QStringLiteral("count")] = histogram.count;
+        probe[QStringLiteral("averageUsecs")] = histogram.count ? histogram.totalNsecs / histogram.count / 1000 : 0;
+        probe[QStringLiteral("maxUsecs")] = histogram.maxNsecs / 1000;
+        probe[QStringLiteral("p50Usecs")] = Private::percentile(histogram, 50);
+        probe[QStringLiteral("p99Usecs")] = Private::percentile(histogram, 99);
+        probe[QStringLiteral("buckets")] = buckets;
+        map[QLatin1String(PROBE_NAMES[i])] = probe;
+    }
+
+    for (int i = 0; i < CounterCount; i++) {
+        map[QLatin1String(COUNTER_NAMES[i])] = d->counters[i];
+    }
+
+    for (int i = 0; i < GaugeCount; i++) {
+        map[QLatin1String(GAUGE_NAMES[i])] = d->gauges[i];
+    }
+
+    return map;
+}
+
+QString TimekeeperStatistics::toString() const
+{
+    QStringList lines;
+
+    for (int i = 0; i < ProbeCount; i++) {
+        const Private::Histogram &histogram = d->histograms[i];
+        lines << QStringLiteral("%1: count %2, avg %3 us, p50 <%4 us, p99 <%5 us, max %6 us")
+                    .arg(QLatin1String(PROBE_NAMES[i]))
+                    .arg(histogram.count)
+                    .arg(histogram.count ? histogram.totalNsecs / histogram.count / 1000 : 0)
+                    .arg(Private::percentile(histogram, 50))
+                    .arg(Private::percentile(histogram, 99))
+                    .arg(histogram.maxNsecs / 1000);
+    }
+
+    for (int i = 0; i < CounterCount; i++) {
+        lines << QStringLiteral("%1: %2").arg(QLatin1String(COUNTER_NAMES[i])).arg(d->counters[i]);
+    }
+
+    for (int i = 0; i < GaugeCount; i++) {
+        lines << QStringLiteral("%1: %2").arg(QLatin1String(GAUGE_NAMES[i])).arg(d->gauges[i]);
+    }
+
+    return lines.join(QLatin1Char('\n'));
+}
+
+#endif // TIMEKEEPER_STATISTICS
@@ -0,0 +1,106 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_STATISTICS_H
+#define PLASMA_TIMEKEEPER_STATISTICS_H
+
+#include <QElapsedTimer>
+#include <QVariantMap>
+
+// Statistics are only collected when built with TIMEKEEPER_STATISTICS, otherwise
+// all the macros below expand to nothing
+#ifdef TIMEKEEPER_STATISTICS
+
+/*                        TimekeeperStatistics                             *
+ * ----------------------------------------------------------------------- */
+
+class TimekeeperStatistics
+{
+public:
+    // Timed operations, each of them has its own latency histogram
+    enum Probe {
+        FocusChangeProbe = 0,
+        TickProbe,
+        ConfigFlushProbe,
+        SleepFlushProbe,
+        ProbeCount
+    };
+
+    enum Counter {
+        ConfigFlushBytesCounter = 0,
+        ModelSignalCounter,
+        CounterCount
+    };
+
+    // Current values, not accumulated
+    enum Gauge {
+        TrackedItemsGauge = 0,
+        TrackedItemsMemoryGauge,
+        GaugeCount
+    };
+
+    static TimekeeperStatistics *self();
+
+    void record(Probe probe, qint64 nsecs);
+    void add(Counter counter, qint64 value);
+    void set(Gauge gauge, qint64 value);
+
+    QVariantMap toVariantMap() const;
+    QString toString() const;
+
+private:
+    TimekeeperStatistics();
+
+    class Private;
+    Private *const d;
+};
+
+class TimekeeperStatisticsScope
+{
+public:
+    explicit TimekeeperStatisticsScope(TimekeeperStatistics::Probe probe)
+        : m_probe(probe)
+    {
+        m_timer.start();
+    }
+
+    ~TimekeeperStatisticsScope()
+    {
+        TimekeeperStatistics::self()->record(m_probe, m_timer.nsecsElapsed());
+    }
+
+private:
+    TimekeeperStatistics::Probe m_probe;
+    QElapsedTimer m_timer;
+};
+
+#define TIMEKEEPER_STATISTICS_SCOPE(probe) TimekeeperStatisticsScope timekeeperStatisticsScope(TimekeeperStatistics::probe)
+#define TIMEKEEPER_STATISTICS_ADD(counter, value) TimekeeperStatistics::self()->add(TimekeeperStatistics::counter, value)
+#define TIMEKEEPER_STATISTICS_SET(gauge, value) TimekeeperStatistics::self()->set(TimekeeperStatistics::gauge, value)
+
+#else
+
+#define TIMEKEEPER_STATISTICS_SCOPE(probe) do { } while (0)
+#define TIMEKEEPER_STATISTICS_ADD(counter, value) do { } while (0)
+#define TIMEKEEPER_STATISTICS_SET(gauge, value) do { } while (0)
+
+#endif // TIMEKEEPER_STATISTICS
+
+#endif // PLASMA_TIMEKEEPER_STATISTICS_H
@@ -0,0 +1,257 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "waylandfocusbackend.h"
+
+#include <KWayland/Client/connection_thread.h>
+#include <KWayland/Client/event_queue.h>
+#include <KWayland/Client/plasmawindowmanagement.h>
+#include <KWayland/Client/registry.h>
+
+#include <QHash>
+#include <QLoggingCategory>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+Q_DECLARE_LOGGING_CATEGORY(PLASMA_TIMEKEEPER)
+
+using namespace KWayland::Client;
+
+/*                     WaylandFocusBackend::Private                        *
+ * ----------------------------------------------------------------------- */
+class WaylandFocusBackend::Private
+{
+public:
+    Private()
+        : queue(0),
+          registry(0),
+          management(0),
+          activeWindow(0)
+    { }
+
+    struct WindowInfo {
+        QPointer<PlasmaWindow> window;
+        QString appId;
+        QPixmap icon;
+        bool iconResolved = false;
+    };
+
+    EventQueue *queue;
+    Registry *registry;
+    PlasmaWindowManagement *management;
+
+    QHash<WId, WindowInfo> windows;
+
+    // Windows asked for which still have no app id
+    QSet<WId> pendingWindows;
+
+    // Windows asked for their icon, rendered in one go later
+    QVector<WId> iconRequests;
+    QTimer iconTimer;
+
+    WId activeWindow;
+};
+
+/*                         WaylandFocusBackend                             *
+ * ----------------------------------------------------------------------- */
+
+WaylandFocusBackend::WaylandFocusBackend(QObject *parent)
+    : FocusBackend(parent),
+      d(new Private())
+{
+    setup(ConnectionThread::fromApplication(this));
+}
+
+WaylandFocusBackend::WaylandFocusBackend(ConnectionThread *connection, QObject *parent)
+    : FocusBackend(parent),
+      d(new Private())
+{
+    setup(connection);
+}
+
+void WaylandFocusBackend::setup(ConnectionThread *connection)
+{
+    d->iconTimer.setSingleShot(true);
+    d->iconTimer.setInterval(0);
+    connect(&d->iconTimer, &QTimer::timeout, this, &WaylandFocusBackend::renderIcons);
+
+    if (!connection) {
+        qCWarning(PLASMA_TIMEKEEPER) << "Failed to get the Wayland connection, focus can't be tracked";
+        return;
+    }
+
+    // Events are dispatched in this thread, whichever thread reads them
+    d->queue = new EventQueue(this);
+    d->queue->setup(connection);
+
+    d->registry = new Registry(this);
+    d->registry->create(connection);
+    d->registry->setEventQueue(d->queue);
+    connect(d->registry, &Registry::plasmaWindowManagementAnnounced, this, &WaylandFocusBackend::plasmaWindowManagementAnnounced);
+    d->registry->setup();
+}
+
+WaylandFocusBackend::~WaylandFocusBackend()
+{
+    delete d;
+}
+
+WId WaylandFocusBackend::activeWindow() const
+{
+    return d->activeWindow;
+}
+
+bool WaylandFocusBackend::isResolved(WId window) const
+{
+    auto it = d->windows.constFind(window);
+    return it != d->windows.constEnd() && !it->appId.isEmpty();
+}
+
+QString WaylandFocusBackend::windowClass(WId window) const
+{
+    return d->windows.value(window).appId;
+}
+
+QPixmap WaylandFocusBackend::windowIcon(WId window)
+{
+    auto it = d->windows.constFind(window);
+    if (it == d->windows.constEnd() || !it->window) {
+        return QPixmap();
+    }
+
+    // Rendering a themed icon may hit the disk, so it's not done on a focus change
+    if (!it->iconResolved && !d->iconRequests.contains(window)) {
+        d->iconRequests << window;
+        d->iconTimer.start();
+    }
+
+    return it->icon;
+}
+
+void WaylandFocusBackend::renderIcons()
+{
+    const QVector<WId> requests = d->iconRequests;
+    d->iconRequests.clear();
+
+    foreach (WId window, requests) {
+        auto it = d->windows.find(window);
+        if (it == d->windows.end() || !it->window || it->iconResolved) {
+            continue;
+        }
+
+        it->icon = it->window->icon().pixmap(64, 64);
+        it->iconResolved = true;
+        Q_EMIT iconResolved(window);
+    }
+}
+
+void WaylandFocusBackend::resolve(WId window)
+{
+    // There is nothing to ask for, the app id is announced once the client sets it
+    if (!isResolved(window)) {
+        d->pendingWindows.insert(window);
+    }
+}
+
+void WaylandFocusBackend::plasmaWindowManagementAnnounced(quint32 name, quint32 version)
+{
+    if (d->management) {
+        return;
+    }
+
+    d->management = d->registry->createPlasmaWindowManagement(name, version, this);
+    connect(d->management, &PlasmaWindowManagement::windowCreated, this, &WaylandFocusBackend::windowCreated);
+    connect(d->management, &PlasmaWindowManagement::activeWindowChanged, this, &WaylandFocusBackend::activeWindowChangedInternal);
+}
+
+void WaylandFocusBackend::windowCreated(PlasmaWindow *window)
+{
+    const WId id = window->internalId();
+
+    // Already known if it got activated before it was announced
+    if (d->windows.contains(id)) {
+        return;
+    }
+
+    Private::WindowInfo info;
+    info.window = window;
+    info.appId = window->appId();
+    d->windows.insert(id, info);
+
+    connect(window, &PlasmaWindow::appIdChanged, this, [this, window, id] () {
+        auto it = d->windows.find(id);
+        if (it == d->windows.end()) {
+            return;
+        }
+
+        it->appId = window->appId();
+        if (it->appId.isEmpty()) {
+            return;
+        }
+
+        // The active window may have changed its app id too, so it gets announced as well
+        if (d->pendingWindows.remove(id) || id == d->activeWindow) {
+            Q_EMIT windowResolved(id);
+        }
+    });
+
+    connect(window, &PlasmaWindow::iconChanged, this, [this, id] () {
+        auto it = d->windows.find(id);
+        if (it != d->windows.end()) {
+            it->icon = QPixmap();
+            it->iconResolved = false;
+        }
+    });
+
+    connect(window, &PlasmaWindow::unmapped, this, [this, id] () {
+        d->windows.remove(id);
+
+        // Waiting for it is over, it just has no app id
+        if (d->pendingWindows.remove(id)) {
+            Q_EMIT windowResolved(id);
+        }
+    });
+
+    // Asked for before we knew the window, its app id may be there already
+    if (!info.appId.isEmpty() && d->pendingWindows.remove(id)) {
+        Q_EMIT windowResolved(id);
+    }
+}
+
+void WaylandFocusBackend::activeWindowChangedInternal()
+{
+    PlasmaWindow *window = d->management->activeWindow();
+    const WId id = window ? window->internalId() : 0;
+
+    if (id == d->activeWindow) {
+        return;
+    }
+
+    // The activation may come before windowCreated(), the window is taken as
+    // it is then and followed from now on
+    if (window) {
+        windowCreated(window);
+    }
+
+    d->activeWindow = id;
+    Q_EMIT activeWindowChanged(id);
+}
@@ -0,0 +1,73 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_WAYLAND_FOCUS_BACKEND_H
+#define PLASMA_TIMEKEEPER_WAYLAND_FOCUS_BACKEND_H
+
+#include "focusbackend.h"
+
+namespace KWayland
+{
+namespace Client
+{
+class ConnectionThread;
+class PlasmaWindow;
+}
+}
+
+/*                         WaylandFocusBackend                             *
+ * ----------------------------------------------------------------------- */
+
+// Follows the active window through the Plasma window management protocol.
+// The compositor pushes the app id, icon and activation of every window, so
+// they are only cached here and nothing is queried when the focus changes.
+// Windows are identified by their internal id. Icons are rendered once the
+// event loop runs again and announced with iconResolved().
+class WaylandFocusBackend : public FocusBackend
+{
+Q_OBJECT
+public:
+    // Uses the connection of the application
+    explicit WaylandFocusBackend(QObject *parent = 0);
+    explicit WaylandFocusBackend(KWayland::Client::ConnectionThread *connection, QObject *parent = 0);
+    virtual ~WaylandFocusBackend();
+
+    WId activeWindow() const Q_DECL_OVERRIDE;
+
+    bool isResolved(WId window) const Q_DECL_OVERRIDE;
+    QString windowClass(WId window) const Q_DECL_OVERRIDE;
+    QPixmap windowIcon(WId window) Q_DECL_OVERRIDE;
+
+    void resolve(WId window) Q_DECL_OVERRIDE;
+
+private Q_SLOTS:
+    void plasmaWindowManagementAnnounced(quint32 name, quint32 version);
+    void windowCreated(KWayland::Client::PlasmaWindow *window);
+    void activeWindowChangedInternal();
+    void renderIcons();
+
+private:
+    void setup(KWayland::Client::ConnectionThread *connection);
+
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_WAYLAND_FOCUS_BACKEND_H
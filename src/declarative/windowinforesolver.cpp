@@ -0,0 +1,361 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "windowinforesolver.h"
+
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QTimer>
+#include <QVector>
+#include <QX11Info>
+
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+
+#include <cstdlib>
+#include <cstring>
+
+// Icons bigger than this many 32 bit values are not worth fetching
+const static quint32 MAXIMUM_ICON_LENGTH = 1 << 20;
+const static int ICON_SIZE = 64;
+
+// Picks the smallest icon at least ICON_SIZE big from a _NET_WM_ICON value,
+// the biggest one if all of them are smaller
+static QImage bestIcon(const xcb_get_property_reply_t *reply)
+{
+    const quint32 *data = static_cast<const quint32 *>(xcb_get_property_value(reply));
+    const qint64 length = xcb_get_property_value_length(reply) / 4;
+
+    const quint32 *best = 0;
+    int bestWidth = 0;
+    int bestHeight = 0;
+
+    qint64 i = 0;
+    while (i + 2 <= length) {
+        const int width = data[i];
+        const int height = data[i + 1];
+        i += 2;
+
+        if (width <= 0 || height <= 0 || qint64(width) * height > length - i) {
+            break;
+        }
+
+        if (!best || (bestWidth < ICON_SIZE && width > bestWidth) || (width >= ICON_SIZE && width < bestWidth)) {
+            best = data + i;
+            bestWidth = width;
+            bestHeight = height;
+        }
+
+        i += qint64(width) * height;
+    }
+
+    if (!best) {
+        return QImage();
+    }
+
+    // The values are non-premultiplied ARGB in host byte order, just like QImage::Format_ARGB32
+    QImage image(bestWidth, bestHeight, QImage::Format_ARGB32);
+    for (int y = 0; y < bestHeight; y++) {
+        memcpy(image.scanLine(y), best + y * bestWidth, bestWidth * 4);
+    }
+
+    return image;
+}
+
+/*                     WindowInfoResolver::Private                         *
+ * ----------------------------------------------------------------------- */
+class WindowInfoResolver::Private
+{
+public:
+    Private()
+        : connection(0),
+          iconAtom(XCB_ATOM_NONE)
+    { }
+
+    struct WindowInfo {
+        QString windowClass;
+        QPixmap icon;
+        bool iconResolved = false;
+    };
+
+    // Request sent to the X server, the reply is picked up with its sequence number
+    struct Request {
+        WId window;
+        unsigned int sequence;
+    };
+
+    void discardRequests(QVector<Request> &requests, WId window);
+
+    QHash<WId, WindowInfo> cache;
+
+    // Windows waiting for their requests to be sent in the next batch
+    QVector<WId> pendingWindows;
+    QVector<WId> pendingIcons;
+    QTimer batchTimer;
+
+    // Requests waiting for their replies
+    QVector<Request> classRequests;
+    QVector<Request> iconRequests;
+    QTimer replyTimer;
+
+    xcb_connection_t *connection;
+    xcb_atom_t iconAtom;
+};
+
+void WindowInfoResolver::Private::discardRequests(QVector<Request> &requests, WId window)
+{
+    for (int i = requests.count() - 1; i >= 0; i--) {
+        if (requests.at(i).window == window) {
+            xcb_discard_reply(connection, requests.at(i).sequence);
+            requests.remove(i);
+        }
+    }
+}
+
+/*                          WindowInfoResolver                             *
+ * ----------------------------------------------------------------------- */
+
+WindowInfoResolver::WindowInfoResolver(QObject *parent)
+    : QObject(parent),
+      d(new Private())
+{
+    d->batchTimer.setSingleShot(true);
+    d->batchTimer.setInterval(0);
+    connect(&d->batchTimer, &QTimer::timeout, this, &WindowInfoResolver::sendRequests);
+
+    // Replies usually arrive within a millisecond, polling for them never blocks
+    d->replyTimer.setInterval(5);
+    connect(&d->replyTimer, &QTimer::timeout, this, &WindowInfoResolver::processReplies);
+
+    if (QX11Info::isPlatformX11()) {
+        d->connection = QX11Info::connection();
+
+        // Only done once when the applet starts
+        const QByteArray name = QByteArrayLiteral("_NET_WM_ICON");
+        xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(d->connection, xcb_intern_atom(d->connection, false, name.length(), name.constData()), 0);
+        if (reply) {
+            d->iconAtom = reply->atom;
+            free(reply);
+        }
+    }
+
+    connect(KWindowSystem::self(), static_cast<void (KWindowSystem::*)(WId, NET::Properties, NET::Properties2)>(&KWindowSystem::windowChanged),
+            this, &WindowInfoResolver::windowChanged);
+    connect(KWindowSystem::self(), &KWindowSystem::windowRemoved, this, &WindowInfoResolver::windowRemoved);
+
+    // Windows are known long before they get focus, so resolve them right away
+    connect(KWindowSystem::self(), &KWindowSystem::windowAdded, this, &WindowInfoResolver::resolve);
+    foreach (WId window, KWindowSystem::windows()) {
+        resolve(window);
+    }
+}
+
+WindowInfoResolver::~WindowInfoResolver()
+{
+    if (d->connection) {
+        foreach (const Private::Request &request, d->classRequests + d->iconRequests) {
+            xcb_discard_reply(d->connection, request.sequence);
+        }
+    }
+
+    delete d;
+}
+
+bool WindowInfoResolver::isResolved(WId window) const
+{
+    return d->cache.contains(window);
+}
+
+QString WindowInfoResolver::windowClass(WId window) const
+{
+    return d->cache.value(window).windowClass;
+}
+
+QPixmap WindowInfoResolver::windowIcon(WId window)
+{
+    auto it = d->cache.find(window);
+    if (it == d->cache.end()) {
+        return QPixmap();
+    }
+
+    // Icons are only needed once per activity, so they are fetched on demand
+    if (!it->iconResolved && !d->pendingIcons.contains(window)) {
+        d->pendingIcons << window;
+        if (!d->batchTimer.isActive()) {
+            d->batchTimer.start();
+        }
+    }
+
+    return it->icon;
+}
+
+void WindowInfoResolver::resolve(WId window)
+{
+    if (!window || d->cache.contains(window) || d->pendingWindows.contains(window)) {
+        return;
+    }
+
+    foreach (const Private::Request &request, d->classRequests) {
+        if (request.window == window) {
+            return;
+        }
+    }
+
+    d->pendingWindows << window;
+
+    if (!d->batchTimer.isActive()) {
+        d->batchTimer.start();
+    }
+}
+
+void WindowInfoResolver::sendRequests()
+{
+    const QVector<WId> windows = d->pendingWindows;
+    const QVector<WId> icons = d->pendingIcons;
+    d->pendingWindows.clear();
+    d->pendingIcons.clear();
+
+    if (!d->connection) {
+        // Without an X server there is nothing to ask
+        foreach (WId window, windows) {
+            d->cache.insert(window, Private::WindowInfo());
+            Q_EMIT windowResolved(window);
+        }
+        return;
+    }
+
+    foreach (WId window, windows) {
+        const xcb_get_property_cookie_t cookie = xcb_get_property(d->connection, false, window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 512);
+        d->classRequests << Private::Request{window, cookie.sequence};
+    }
+
+    foreach (WId window, icons) {
+        const xcb_get_property_cookie_t cookie = xcb_get_property(d->connection, false, window, d->iconAtom, XCB_ATOM_CARDINAL, 0, MAXIMUM_ICON_LENGTH);
+        d->iconRequests << Private::Request{window, cookie.sequence};
+    }
+
+    xcb_flush(d->connection);
+
+    if (!d->replyTimer.isActive()) {
+        d->replyTimer.start();
+    }
+}
+
+void WindowInfoResolver::processReplies()
+{
+    QVector<WId> resolvedWindows;
+    QVector<WId> resolvedIcons;
+
+    // Replies come in the order of the requests, so stop at the first one still missing
+    while (!d->classRequests.isEmpty()) {
+        const Private::Request request = d->classRequests.first();
+        void *reply = 0;
+        xcb_generic_error_t *error = 0;
+        if (!xcb_poll_for_reply(d->connection, request.sequence, &reply, &error)) {
+            break;
+        }
+        d->classRequests.removeFirst();
+        free(error);
+
+        // Windows gone meanwhile are still announced, but not cached
+        xcb_get_property_reply_t *propertyReply = static_cast<xcb_get_property_reply_t *>(reply);
+        if (propertyReply && KWindowSystem::hasWId(request.window)) {
+            const char *value = static_cast<const char *>(xcb_get_property_value(propertyReply));
+            const int length = xcb_get_property_value_length(propertyReply);
+
+            // WM_CLASS holds the instance and the class name, we use the instance one
+            Private::WindowInfo windowInfo;
+            windowInfo.windowClass = QString::fromUtf8(value, qstrnlen(value, length));
+            d->cache.insert(request.window, windowInfo);
+        }
+        free(reply);
+
+        resolvedWindows << request.window;
+    }
+
+    while (!d->iconRequests.isEmpty()) {
+        const Private::Request request = d->iconRequests.first();
+        void *reply = 0;
+        xcb_generic_error_t *error = 0;
+        if (!xcb_poll_for_reply(d->connection, request.sequence, &reply, &error)) {
+            break;
+        }
+        d->iconRequests.removeFirst();
+        free(error);
+
+        auto it = d->cache.find(request.window);
+        if (it != d->cache.end()) {
+            QImage image = reply ? bestIcon(static_cast<xcb_get_property_reply_t *>(reply)) : QImage();
+            if (image.isNull()) {
+                it->icon = QIcon::fromTheme(it->windowClass.toLower()).pixmap(ICON_SIZE, ICON_SIZE);
+            } else {
+                if (image.width() != ICON_SIZE || image.height() != ICON_SIZE) {
+                    image = image.scaled(ICON_SIZE, ICON_SIZE, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                }
+                it->icon = QPixmap::fromImage(image);
+            }
+            it->iconResolved = true;
+            resolvedIcons << request.window;
+        }
+        free(reply);
+    }
+
+    if (d->classRequests.isEmpty() && d->iconRequests.isEmpty()) {
+        d->replyTimer.stop();
+    }
+
+    foreach (WId window, resolvedWindows) {
+        Q_EMIT windowResolved(window);
+    }
+
+    foreach (WId window, resolvedIcons) {
+        Q_EMIT iconResolved(window);
+    }
+}
+
+void WindowInfoResolver::windowChanged(WId window, NET::Properties properties, NET::Properties2 properties2)
+{
+    auto it = d->cache.find(window);
+    if (it == d->cache.end()) {
+        return;
+    }
+
+    if (properties2 & NET::WM2WindowClass) {
+        d->cache.erase(it);
+        d->discardRequests(d->iconRequests, window);
+        resolve(window);
+    } else if (properties & NET::WMIcon) {
+        it->icon = QPixmap();
+        it->iconResolved = false;
+        d->discardRequests(d->iconRequests, window);
+    }
+}
+
+void WindowInfoResolver::windowRemoved(WId window)
+{
+    // Pending class requests still get answered, with an error, so whoever
+    // waits for the window learns that it is gone
+    d->cache.remove(window);
+    d->pendingIcons.removeAll(window);
+    if (d->connection) {
+        d->discardRequests(d->iconRequests, window);
+    }
+}
@@ -0,0 +1,67 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_WINDOW_INFO_RESOLVER_H
+#define PLASMA_TIMEKEEPER_WINDOW_INFO_RESOLVER_H
+
+#include <QObject>
+#include <QPixmap>
+#include <QWindow>
+
+#include <KWindowSystem>
+
+/*                          WindowInfoResolver                             *
+ * ----------------------------------------------------------------------- */
+
+// Caches the window class and icon per window id so the focus change handler
+// never has to wait for the display server. Windows are prefetched as soon as
+// they are mapped, the requests are sent in batches and their replies picked
+// up once they arrived, so nothing ever waits for a round trip.
+class WindowInfoResolver : public QObject
+{
+Q_OBJECT
+public:
+    explicit WindowInfoResolver(QObject *parent = 0);
+    virtual ~WindowInfoResolver();
+
+    bool isResolved(WId window) const;
+    QString windowClass(WId window) const;
+
+    // Null until the icon arrived, which is announced with iconResolved()
+    QPixmap windowIcon(WId window);
+
+    void resolve(WId window);
+
+Q_SIGNALS:
+    void windowResolved(WId window);
+    void iconResolved(WId window);
+
+private Q_SLOTS:
+    void sendRequests();
+    void processReplies();
+    void windowChanged(WId window, NET::Properties properties, NET::Properties2 properties2);
+    void windowRemoved(WId window);
+
+private:
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_WINDOW_INFO_RESOLVER_H
@@ -0,0 +1,80 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "x11focusbackend.h"
+#include "windowinforesolver.h"
+
+#include <KWindowSystem>
+
+/*                       X11FocusBackend::Private                          *
+ * ----------------------------------------------------------------------- */
+class X11FocusBackend::Private
+{
+public:
+    Private()
+        : resolver(0)
+    { }
+
+    WindowInfoResolver *resolver;
+};
+
+/*                           X11FocusBackend                               *
+ * ----------------------------------------------------------------------- */
+
+X11FocusBackend::X11FocusBackend(QObject *parent)
+    : FocusBackend(parent),
+      d(new Private())
+{
+    d->resolver = new WindowInfoResolver(this);
+    connect(d->resolver, &WindowInfoResolver::windowResolved, this, &FocusBackend::windowResolved);
+    connect(d->resolver, &WindowInfoResolver::iconResolved, this, &FocusBackend::iconResolved);
+
+    connect(KWindowSystem::self(), &KWindowSystem::activeWindowChanged, this, &FocusBackend::activeWindowChanged);
+}
+
+X11FocusBackend::~X11FocusBackend()
+{
+    delete d;
+}
+
+WId X11FocusBackend::activeWindow() const
+{
+    return KWindowSystem::activeWindow();
+}
+
+bool X11FocusBackend::isResolved(WId window) const
+{
+    return d->resolver->isResolved(window);
+}
+
+QString X11FocusBackend::windowClass(WId window) const
+{
+    return d->resolver->windowClass(window);
+}
+
+QPixmap X11FocusBackend::windowIcon(WId window)
+{
+    return d->resolver->windowIcon(window);
+}
+
+void X11FocusBackend::resolve(WId window)
+{
+    d->resolver->resolve(window);
+}
@@ -0,0 +1,51 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_X11_FOCUS_BACKEND_H
+#define PLASMA_TIMEKEEPER_X11_FOCUS_BACKEND_H
+
+#include "focusbackend.h"
+
+/*                           X11FocusBackend                               *
+ * ----------------------------------------------------------------------- */
+
+// Follows the active window through KWindowSystem, window classes and icons
+// come from the cache of the WindowInfoResolver.
+class X11FocusBackend : public FocusBackend
+{
+Q_OBJECT
+public:
+    explicit X11FocusBackend(QObject *parent = 0);
+    virtual ~X11FocusBackend();
+
+    WId activeWindow() const Q_DECL_OVERRIDE;
+
+    bool isResolved(WId window) const Q_DECL_OVERRIDE;
+    QString windowClass(WId window) const Q_DECL_OVERRIDE;
+    QPixmap windowIcon(WId window) Q_DECL_OVERRIDE;
+
+    void resolve(WId window) Q_DECL_OVERRIDE;
+
+private:
+    class Private;
+    Private *const d;
+};
+
+#endif // PLASMA_TIMEKEEPER_X11_FOCUS_BACKEND_H
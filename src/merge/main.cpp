@@ -0,0 +1,60 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitymerger.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("timekeeper-merge"));
+    QCoreApplication::setApplicationVersion(QStringLiteral("1.0"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Merges histories exported by timekeeper-query --export into one history"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption outputOption(QStringList() << QStringLiteral("o") << QStringLiteral("output"), QStringLiteral("History to write, replaced once the merge succeeded."), QStringLiteral("path"));
+    parser.addOption(outputOption);
+    parser.addPositionalArgument(QStringLiteral("exports"), QStringLiteral("Exports to merge."), QStringLiteral("exports..."));
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    const QStringList paths = parser.positionalArguments();
+    if (!parser.isSet(outputOption) || paths.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    ActivityMerger merger;
+    if (!merger.merge(paths, parser.value(outputOption))) {
+        err << merger.errorString() << endl;
+        return 1;
+    }
+
+    err << "Merged " << merger.merged() << " intervals from " << paths.count() << " exports, "
+        << merger.trimmed() << " overlapping trimmed, " << merger.sortedExports() << " unsorted exports sorted first" << endl;
+
+    return 0;
+}
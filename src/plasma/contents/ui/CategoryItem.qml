@@ -0,0 +1,72 @@
+/***************************************************************************
+ *   Copyright (C) 2016-2018 by Jan Grulich <jgrulich@redhat.com>          *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA .        *
+ ***************************************************************************/
+
+import QtQuick 2.2
+import org.kde.plasma.core 2.0 as PlasmaCore
+import org.kde.plasma.components 2.0 as PlasmaComponents
+
+PlasmaComponents.ListItem {
+    id: categoryItem
+
+    enabled: true
+    checked: categoryItem.containsMouse
+    height: categoryName.height + categoryTime.height + Math.round(units.gridUnit / 2)
+
+    PlasmaCore.IconItem {
+        id: categoryIcon
+
+        anchors {
+            left: parent.left
+            leftMargin: Math.round(units.gridUnit / 3)
+            verticalCenter: parent.verticalCenter
+        }
+        source: "folder"
+        height: parent.height; width: height
+    }
+
+    PlasmaComponents.Label {
+        id: categoryName
+
+        anchors {
+            bottom: categoryIcon.verticalCenter
+            left: categoryIcon.right
+            leftMargin: Math.round(units.gridUnit / 2)
+            right: parent.right
+        }
+        height: paintedHeight
+        elide: Text.ElideRight
+        text: CategoryName
+    }
+
+    PlasmaComponents.Label {
+        id: categoryTime
+
+        anchors {
+            left: categoryIcon.right
+            leftMargin: Math.round(units.gridUnit / 2)
+            right: parent.right
+            top: categoryName.bottom
+        }
+        height: paintedHeight
+        elide: Text.ElideRight
+        font.pointSize: theme.smallestFont.pointSize
+        opacity: 0.6
+        text: i18np("%2 (%3%), %1 application", "%2 (%3%), %1 applications", CategoryActivityCount, CategoryTime, CategoryPercentualUsage)
+    }
+}
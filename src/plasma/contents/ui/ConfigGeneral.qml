@@ -31,6 +31,12 @@ Item {
     property alias cfg_reset_on_suspend: resetOnSuspendCheckbox.checked
     property alias cfg_reset_on_shutdown: resetOnShutdownCheckbox.checked
     property alias cfg_show_total_activity_time: showTotalActivityTimeCheckbox.checked
+    property alias cfg_current_partition_only: currentPartitionOnlyCheckbox.checked
+    property alias cfg_maximum_activity_count: maximumActivityCountSpinBox.value
+    property alias cfg_minimum_activity_time: minimumActivityTimeSpinBox.value
+    property alias cfg_archive_after_days: archiveAfterDaysSpinBox.value
+    property alias cfg_activity_rules: activityRulesTextArea.text
+    property alias cfg_usage_limits: usageLimitsTextArea.text
 
     Label {
         id: resetLabel
@@ -77,4 +83,142 @@ Item {
             topMargin: Math.round(units.gridUnit / 3)
         }
     }
+    CheckBox {
+        id: currentPartitionOnlyCheckbox
+        text: i18n("Only show time spent on the current desktop and activity")
+        anchors {
+            left: parent.left
+            top: showTotalActivityTimeCheckbox.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+    }
+    Row {
+        id: maximumActivityCountRow
+        anchors {
+            left: parent.left
+            top: currentPartitionOnlyCheckbox.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+        spacing: units.smallSpacing
+
+        Label {
+            anchors.verticalCenter: parent.verticalCenter
+            text: i18n("Show at most:")
+        }
+
+        SpinBox {
+            id: maximumActivityCountSpinBox
+            minimumValue: 0
+            maximumValue: 999
+            suffix: i18nc("Number of shown applications, 0 means all of them", " applications")
+        }
+    }
+    Row {
+        id: minimumActivityTimeRow
+        anchors {
+            left: parent.left
+            top: maximumActivityCountRow.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+        spacing: units.smallSpacing
+
+        Label {
+            anchors.verticalCenter: parent.verticalCenter
+            text: i18n("Hide applications used less than:")
+        }
+
+        SpinBox {
+            id: minimumActivityTimeSpinBox
+            minimumValue: 0
+            maximumValue: 24 * 60
+            suffix: i18n(" min")
+        }
+    }
+    Row {
+        id: archiveAfterDaysRow
+        anchors {
+            left: parent.left
+            top: minimumActivityTimeRow.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+        spacing: units.smallSpacing
+
+        Label {
+            anchors.verticalCenter: parent.verticalCenter
+            text: i18n("Hide applications not used for:")
+        }
+
+        SpinBox {
+            id: archiveAfterDaysSpinBox
+            minimumValue: 0
+            maximumValue: 365
+            suffix: i18nc("Number of days, 0 means never hide them", " days")
+        }
+    }
+    Label {
+        id: activityRulesLabel
+        anchors {
+            left: parent.left
+            top: archiveAfterDaysRow.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+        text: i18n("Activity rules:")
+    }
+    TextArea {
+        id: activityRulesTextArea
+        anchors {
+            left: parent.left
+            top: activityRulesLabel.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+        width: units.gridUnit * 20
+        height: units.gridUnit * 6
+        font.family: "monospace"
+    }
+    Label {
+        id: activityRulesHintLabel
+        anchors {
+            left: parent.left
+            top: activityRulesTextArea.bottom
+        }
+        width: activityRulesTextArea.width
+        wrapMode: Text.WordWrap
+        textFormat: Text.PlainText
+        font.pointSize: theme.smallestFont.pointSize
+        opacity: 0.6
+        text: i18n("One rule per line: <action> <syntax> <pattern> [value], where action is ignore, rename or category and syntax is exact, glob or regex. For example \"category glob org.kde.* KDE\". Applications ignored from the popup are added as ignore rules, remove the rule to track them again.")
+    }
+    Label {
+        id: usageLimitsLabel
+        anchors {
+            left: parent.left
+            top: activityRulesHintLabel.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+        text: i18n("Daily usage limits:")
+    }
+    TextArea {
+        id: usageLimitsTextArea
+        anchors {
+            left: parent.left
+            top: usageLimitsLabel.bottom
+            topMargin: Math.round(units.gridUnit / 3)
+        }
+        width: units.gridUnit * 20
+        height: units.gridUnit * 4
+        font.family: "monospace"
+    }
+    Label {
+        id: usageLimitsHintLabel
+        anchors {
+            left: parent.left
+            top: usageLimitsTextArea.bottom
+        }
+        width: usageLimitsTextArea.width
+        wrapMode: Text.WordWrap
+        textFormat: Text.PlainText
+        font.pointSize: theme.smallestFont.pointSize
+        opacity: 0.6
+        text: i18n("One limit per line: <application> = <minutes> or @<category> = <minutes>. For example \"@Chat = 60\".")
+    }
 }
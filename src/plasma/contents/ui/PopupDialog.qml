@@ -31,6 +31,100 @@ Item {
     Layout.minimumWidth: units.gridUnit * 12
     Layout.minimumHeight: units.gridUnit * 12
 
+    PlasmaTimekeeper.ActivityTimelineModel {
+        id: timelineModel
+
+        // Shown range in milliseconds since epoch, today by default
+        property real viewFrom: new Date().setHours(0, 0, 0, 0)
+        property real viewTo: viewFrom + 24 * 3600 * 1000
+        // Day the range was last moved to, unless scrolled or zoomed since
+        property real followedDay: viewFrom
+
+        // Moves on to the new day after midnight, if the view still shows the whole old one
+        function followToday() {
+            var today = new Date().setHours(0, 0, 0, 0)
+            if (followedDay != today && viewFrom == followedDay && viewTo == followedDay + 24 * 3600 * 1000) {
+                viewFrom = today
+                viewTo = today + 24 * 3600 * 1000
+                followedDay = today
+            }
+        }
+
+        from: new Date(viewFrom)
+        to: new Date(viewTo)
+        pixelWidth: timeline.width
+        maximumLanes: 6
+        active: plasmoid.expanded
+    }
+
+    Timer {
+        interval: 60 * 1000
+        repeat: true
+        running: plasmoid.expanded
+        triggeredOnStart: true
+        onTriggered: timelineModel.followToday()
+    }
+
+    Column {
+        id: laneLabels
+
+        anchors {
+            left: parent.left
+            top: timeline.top
+        }
+        width: units.gridUnit * 5
+
+        Repeater {
+            model: timelineModel.laneActivities
+
+            PlasmaComponents.Label {
+                width: laneLabels.width
+                height: timeline.height / timelineModel.laneCount
+                elide: Text.ElideRight
+                font.pointSize: theme.smallestFont.pointSize
+                verticalAlignment: Text.AlignVCenter
+                text: modelData
+            }
+        }
+    }
+
+    PlasmaTimekeeper.ActivityTimeline {
+        id: timeline
+
+        anchors {
+            left: laneLabels.right
+            leftMargin: units.smallSpacing
+            right: parent.right
+            top: parent.top
+        }
+        // Every lane stays tall enough for its label
+        height: Math.max(units.gridUnit * 2, timelineModel.laneCount * Math.round(units.gridUnit * 0.8))
+        model: timelineModel
+
+        MouseArea {
+            property real lastX
+
+            anchors.fill: parent
+
+            // Zoom around the pointer, between a quarter of an hour and a week
+            onWheel: {
+                var span = timelineModel.viewTo - timelineModel.viewFrom
+                var newSpan = Math.max(15 * 60 * 1000, Math.min(7 * 24 * 3600 * 1000, wheel.angleDelta.y > 0 ? span * 0.8 : span * 1.25))
+                var anchor = timelineModel.viewFrom + span * wheel.x / width
+                timelineModel.viewFrom = anchor - newSpan * wheel.x / width
+                timelineModel.viewTo = timelineModel.viewFrom + newSpan
+            }
+
+            onPressed: lastX = mouse.x
+            onPositionChanged: {
+                var shift = (timelineModel.viewTo - timelineModel.viewFrom) * (lastX - mouse.x) / width
+                timelineModel.viewFrom += shift
+                timelineModel.viewTo += shift
+                lastX = mouse.x
+            }
+        }
+    }
+
     PlasmaExtras.ScrollArea {
         id: connectionScrollView
 
@@ -39,7 +133,8 @@ Item {
             bottomMargin: Math.round(units.gridUnit / 3)
             left: parent.left
             right: parent.right
-            top: parent.top
+            top: timeline.bottom
+            topMargin: Math.round(units.gridUnit / 3)
         }
 
         ListView {
@@ -49,10 +144,34 @@ Item {
 
             anchors.fill: parent
             clip: true
-            model: activitySortModel
+            model: plasmoid.configuration.show_categories ? activityCategoryModel : activitySortModel
             currentIndex: -1
             boundsBehavior: Flickable.StopAtBounds
-            delegate: ActivityItem { }
+            delegate: plasmoid.configuration.show_categories ? categoryDelegate : activityDelegate
+            footer: PlasmaComponents.Label {
+                anchors {
+                    left: parent.left
+                    leftMargin: Math.round(units.gridUnit / 3)
+                    right: parent.right
+                }
+                height: visible ? paintedHeight + Math.round(units.gridUnit / 2) : 0
+                visible: !plasmoid.configuration.show_categories && activitySortModel.restCount > 0
+                elide: Text.ElideRight
+                font.pointSize: theme.smallestFont.pointSize
+                opacity: 0.6
+                verticalAlignment: Text.AlignVCenter
+                text: i18np("%1 more application (%2)", "%1 more applications (%2)", activitySortModel.restCount, activitySortModel.restTime)
+            }
+        }
+
+        Component {
+            id: activityDelegate
+            ActivityItem { }
+        }
+
+        Component {
+            id: categoryDelegate
+            CategoryItem { }
         }
     }
 
@@ -77,6 +196,18 @@ Item {
             }
         }
 
+        PlasmaComponents.Button {
+            id: showCategoriesButton
+            checkable: true
+            checked: plasmoid.configuration.show_categories
+            iconSource: "folder"
+            text: i18n("Categories")
+
+            onClicked: {
+                plasmoid.configuration.show_categories = checked
+            }
+        }
+
         PlasmaComponents.Button {
             id: resetTrackingButton
             iconSource: "view-refresh"
@@ -36,11 +36,30 @@ Item {
         id: activityModel
         resetOnSuspend: plasmoid.configuration.reset_on_suspend
         resetOnShutdown: plasmoid.configuration.reset_on_shutdown
+        archiveAfterDays: plasmoid.configuration.archive_after_days
+        activityRules: plasmoid.configuration.activity_rules.split("\n")
+        onActivityRulesChanged: plasmoid.configuration.activity_rules = activityRules.join("\n")
+        usageLimits: plasmoid.configuration.usage_limits.split("\n")
+    }
+
+    PlasmaTimekeeper.ActivityPartitionModel {
+        id: activityPartitionModel
+        sourceModel: activityModel
+        desktop: plasmoid.configuration.current_partition_only ? activityModel.currentDesktop : 0
+        kdeActivity: plasmoid.configuration.current_partition_only ? activityModel.currentKdeActivity : ""
+    }
+
+    // Time per category of the shown partition
+    PlasmaTimekeeper.ActivityCategoryModel {
+        id: activityCategoryModel
+        sourceModel: activityPartitionModel
     }
 
     PlasmaTimekeeper.ActivitySortModel {
         id: activitySortModel
-        sourceModel: activityModel
+        sourceModel: activityPartitionModel
+        maximumCount: plasmoid.configuration.maximum_activity_count
+        minimumSeconds: plasmoid.configuration.minimum_activity_time * 60
     }
 
     Plasmoid.compactRepresentation: CompactRepresentation { }
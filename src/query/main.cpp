@@ -0,0 +1,391 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityexport.h"
+#include "activityhistory.h"
+#include "activityrules.h"
+#include "durationformat.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+enum Grouping {
+    ActivityGrouping,
+    CategoryGrouping,
+    UserGrouping,
+    DayGrouping,
+    HourGrouping
+};
+
+struct Aggregation {
+    Grouping grouping;
+
+    // Category index of every activity, -1 when uncategorized
+    QVector<int> categories;
+
+    // Only the part of intervals within this range is counted, in msecs since epoch
+    qint64 from;
+    qint64 to;
+};
+
+// Milliseconds per group
+typedef QHash<qint64, qint64> Totals;
+
+struct Row {
+    QString name;
+    qint64 key;
+    qint64 msecs;
+};
+
+static void aggregateInterval(const Aggregation &aggregation, const ActivityHistory::Interval &interval, Totals *totals)
+{
+    qint64 start = qMax(interval.start, aggregation.from);
+    const qint64 end = qMin(interval.start + qint64(interval.seconds) * 1000, aggregation.to);
+
+    if (end <= start) {
+        return;
+    }
+
+    switch (aggregation.grouping) {
+        case ActivityGrouping:
+            (*totals)[interval.activity] += end - start;
+            break;
+        case CategoryGrouping:
+            (*totals)[aggregation.categories.value(interval.activity, -1)] += end - start;
+            break;
+        case UserGrouping:
+            (*totals)[interval.user] += end - start;
+            break;
+        case DayGrouping:
+        case HourGrouping:
+            // Split the interval on hour boundaries of the local time
+            while (start < end) {
+                const QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(start);
+                const QDateTime hourStart(dateTime.date(), QTime(dateTime.time().hour(), 0));
+                const qint64 sliceEnd = qMin(end, hourStart.addSecs(3600).toMSecsSinceEpoch());
+                const qint64 key = aggregation.grouping == DayGrouping ? dateTime.date().toJulianDay() : dateTime.time().hour();
+
+                // Guard against DST transitions not moving us forward
+                const qint64 sliceLength = qMax<qint64>(sliceEnd - start, 1);
+                (*totals)[key] += sliceLength;
+                start += sliceLength;
+            }
+            break;
+    }
+}
+
+static Totals aggregateChunk(const Aggregation &aggregation, const ActivityHistory::Interval *begin, const ActivityHistory::Interval *end)
+{
+    Totals totals;
+    for (const ActivityHistory::Interval *it = begin; it != end; ++it) {
+        aggregateInterval(aggregation, *it, &totals);
+    }
+    return totals;
+}
+
+static QString csvField(const QString &field)
+{
+    if (!field.contains(QLatin1Char(',')) && !field.contains(QLatin1Char('"'))) {
+        return field;
+    }
+
+    QString escaped = field;
+    escaped.replace(QLatin1Char('"'), QLatin1String("\"\""));
+    return QLatin1Char('"') + escaped + QLatin1Char('"');
+}
+
+static bool parseDateTime(const QString &value, bool endOfDay, qint64 *msecs)
+{
+    QDateTime dateTime = QDateTime::fromString(value, Qt::ISODate);
+    if (!dateTime.isValid()) {
+        return false;
+    }
+
+    // Plain dates include the whole day when used as the end of the range
+    if (endOfDay && value.length() == 10) {
+        dateTime = dateTime.addDays(1);
+    }
+
+    *msecs = dateTime.toMSecsSinceEpoch();
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("timekeeper-query"));
+    QCoreApplication::setApplicationVersion(QStringLiteral("1.0"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Aggregates the usage history recorded by Plasma Timekeeper"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption historyOption(QStringLiteral("history"), QStringLiteral("History to read, the default one if not given."), QStringLiteral("path"), ActivityHistory::defaultPath());
+    QCommandLineOption groupByOption(QStringLiteral("group-by"), QStringLiteral("Group by activity, category, user, day or hour."), QStringLiteral("grouping"), QStringLiteral("activity"));
+    QCommandLineOption fromOption(QStringLiteral("from"), QStringLiteral("Only count usage since the given ISO date or date and time."), QStringLiteral("date"));
+    QCommandLineOption toOption(QStringLiteral("to"), QStringLiteral("Only count usage until the given ISO date or date and time."), QStringLiteral("date"));
+    QCommandLineOption topOption(QStringLiteral("top"), QStringLiteral("Only show the given number of groups with the most usage."), QStringLiteral("count"), QStringLiteral("0"));
+    QCommandLineOption rulesOption(QStringLiteral("rules"), QStringLiteral("File with activity rules used to assign categories, one per line."), QStringLiteral("path"));
+    QCommandLineOption formatOption(QStringLiteral("format"), QStringLiteral("Output as table, csv or json."), QStringLiteral("format"), QStringLiteral("table"));
+    QCommandLineOption exportOption(QStringLiteral("export"), QStringLiteral("Export the intervals starting within the range for timekeeper-merge instead of aggregating them, \"-\" writes to the standard output."), QStringLiteral("path"));
+    QCommandLineOption userOption(QStringLiteral("user"), QStringLiteral("User of the intervals recorded by this session, in exports and when grouping by user."), QStringLiteral("name"), QString::fromLocal8Bit(qgetenv("USER")));
+    QCommandLineOption hostOption(QStringLiteral("host"), QStringLiteral("Host recorded in the export."), QStringLiteral("name"), QSysInfo::machineHostName());
+    QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("Number of threads to scan the history with."), QStringLiteral("count"), QString::number(QThread::idealThreadCount()));
+
+    parser.addOptions({ historyOption, groupByOption, fromOption, toOption, topOption, rulesOption, formatOption, exportOption, userOption, hostOption, threadsOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    Aggregation aggregation;
+    aggregation.from = std::numeric_limits<qint64>::min() / 2;
+    aggregation.to = std::numeric_limits<qint64>::max() / 2;
+
+    const QString groupBy = parser.value(groupByOption);
+    if (groupBy == QLatin1String("activity")) {
+        aggregation.grouping = ActivityGrouping;
+    } else if (groupBy == QLatin1String("category")) {
+        aggregation.grouping = CategoryGrouping;
+    } else if (groupBy == QLatin1String("user")) {
+        aggregation.grouping = UserGrouping;
+    } else if (groupBy == QLatin1String("day")) {
+        aggregation.grouping = DayGrouping;
+    } else if (groupBy == QLatin1String("hour")) {
+        aggregation.grouping = HourGrouping;
+    } else {
+        err << "Unknown grouping " << groupBy << endl;
+        return 1;
+    }
+
+    if (parser.isSet(fromOption) && !parseDateTime(parser.value(fromOption), false, &aggregation.from)) {
+        err << "Invalid date " << parser.value(fromOption) << endl;
+        return 1;
+    }
+
+    if (parser.isSet(toOption) && !parseDateTime(parser.value(toOption), true, &aggregation.to)) {
+        err << "Invalid date " << parser.value(toOption) << endl;
+        return 1;
+    }
+
+    const QString format = parser.value(formatOption);
+    if (format != QLatin1String("table") && format != QLatin1String("csv") && format != QLatin1String("json")) {
+        err << "Unknown format " << format << endl;
+        return 1;
+    }
+
+    ActivityHistory history(parser.value(historyOption));
+    if (!history.open()) {
+        err << "Can't open history " << history.path() << endl;
+        return 1;
+    }
+
+    const QStringList activities = history.activities();
+    const QStringList users = history.users();
+
+    if (parser.isSet(exportOption)) {
+        const QString exportPath = parser.value(exportOption);
+
+        ActivityExportWriter writer;
+        if (!writer.open(exportPath == QLatin1String("-") ? QString() : exportPath, parser.value(userOption), parser.value(hostOption))) {
+            err << "Can't write export " << exportPath << endl;
+            return 1;
+        }
+
+        const ActivityHistory::Interval *intervals = history.intervals();
+        const qint64 last = history.lowerBound(aggregation.to);
+        for (qint64 i = history.lowerBound(aggregation.from); i < last; i++) {
+            ActivityExportRecord record;
+            record.start = intervals[i].start;
+            record.seconds = intervals[i].seconds;
+            record.activity = activities.value(intervals[i].activity);
+            // Intervals of merged histories keep their user
+            if (intervals[i].user != ActivityHistory::NoUser) {
+                record.user = users.value(intervals[i].user);
+            }
+            if (!writer.write(record)) {
+                err << "Can't write export " << exportPath << endl;
+                return 1;
+            }
+        }
+
+        return 0;
+    }
+
+    QStringList categoryNames;
+    if (aggregation.grouping == CategoryGrouping) {
+        ActivityRules rules;
+        if (parser.isSet(rulesOption)) {
+            QFile rulesFile(parser.value(rulesOption));
+            if (!rulesFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                err << "Can't open rules " << rulesFile.fileName() << endl;
+                return 1;
+            }
+            rules.setRules(QString::fromUtf8(rulesFile.readAll()).split(QLatin1Char('\n')));
+        }
+
+        foreach (const QString &activity, activities) {
+            const QString category = rules.match(activity).category;
+            if (category.isEmpty()) {
+                aggregation.categories << -1;
+                continue;
+            }
+
+            int index = categoryNames.indexOf(category);
+            if (index < 0) {
+                index = categoryNames.count();
+                categoryNames << category;
+            }
+            aggregation.categories << index;
+        }
+    }
+
+    // Only intervals which can intersect the range are scanned, split into one chunk per thread
+    const ActivityHistory::Interval *intervals = history.intervals();
+    QVector<qint64> earlier;
+    const qint64 first = history.firstIntersecting(aggregation.from, &earlier);
+    const qint64 last = history.lowerBound(aggregation.to);
+    const int threads = qMax(1, parser.value(threadsOption).toInt());
+    const qint64 chunkSize = qMax<qint64>((last - first + threads - 1) / threads, 1);
+
+    QVector<QFuture<Totals> > futures;
+    for (qint64 begin = first; begin < last; begin += chunkSize) {
+        const ActivityHistory::Interval *chunkBegin = intervals + begin;
+        const ActivityHistory::Interval *chunkEnd = intervals + qMin(begin + chunkSize, last);
+        futures << QtConcurrent::run([&aggregation, chunkBegin, chunkEnd] () {
+            return aggregateChunk(aggregation, chunkBegin, chunkEnd);
+        });
+    }
+
+    // Long intervals starting before the chunks are few, they are done right here
+    QVector<Totals> results;
+    results << Totals();
+    foreach (qint64 index, earlier) {
+        aggregateInterval(aggregation, intervals[index], &results.first());
+    }
+
+    foreach (QFuture<Totals> future, futures) {
+        results << future.result();
+    }
+
+    Totals totals;
+    qint64 totalMsecs = 0;
+    foreach (const Totals &chunkTotals, results) {
+        for (auto it = chunkTotals.constBegin(); it != chunkTotals.constEnd(); ++it) {
+            totals[it.key()] += it.value();
+            totalMsecs += it.value();
+        }
+    }
+
+    QVector<Row> rows;
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        Row row;
+        row.key = it.key();
+        row.msecs = it.value();
+
+        switch (aggregation.grouping) {
+            case ActivityGrouping:
+                row.name = activities.value(it.key(), QStringLiteral("unknown"));
+                break;
+            case CategoryGrouping:
+                row.name = it.key() >= 0 ? categoryNames.at(it.key()) : QStringLiteral("Uncategorized");
+                break;
+            case UserGrouping:
+                row.name = it.key() == ActivityHistory::NoUser ? parser.value(userOption) : users.value(it.key(), QStringLiteral("unknown"));
+                break;
+            case DayGrouping:
+                row.name = QDate::fromJulianDay(it.key()).toString(Qt::ISODate);
+                break;
+            case HourGrouping:
+                row.name = QStringLiteral("%1:00").arg(it.key(), 2, 10, QLatin1Char('0'));
+                break;
+        }
+
+        rows << row;
+    }
+
+    // Days and hours are shown in their natural order, unless only the top of them is wanted
+    const int top = parser.value(topOption).toInt();
+    if (top > 0 || aggregation.grouping == ActivityGrouping || aggregation.grouping == CategoryGrouping || aggregation.grouping == UserGrouping) {
+        std::sort(rows.begin(), rows.end(), [] (const Row &left, const Row &right) {
+            return left.msecs > right.msecs;
+        });
+    } else {
+        std::sort(rows.begin(), rows.end(), [] (const Row &left, const Row &right) {
+            return left.key < right.key;
+        });
+    }
+
+    if (top > 0 && rows.count() > top) {
+        rows.resize(top);
+    }
+
+    if (format == QLatin1String("json")) {
+        QJsonArray jsonRows;
+        foreach (const Row &row, rows) {
+            QJsonObject jsonRow;
+            jsonRow[QStringLiteral("name")] = row.name;
+            jsonRow[QStringLiteral("seconds")] = row.msecs / 1000;
+            jsonRow[QStringLiteral("percent")] = totalMsecs ? row.msecs * 100.0 / totalMsecs : 0.0;
+            jsonRows << jsonRow;
+        }
+
+        QJsonObject json;
+        json[QStringLiteral("groupBy")] = groupBy;
+        json[QStringLiteral("totalSeconds")] = totalMsecs / 1000;
+        json[QStringLiteral("rows")] = jsonRows;
+        out << QJsonDocument(json).toJson();
+    } else if (format == QLatin1String("csv")) {
+        out << groupBy << ",seconds,percent" << endl;
+        foreach (const Row &row, rows) {
+            out << csvField(row.name) << ',' << row.msecs / 1000 << ',' << QString::number(totalMsecs ? row.msecs * 100.0 / totalMsecs : 0.0, 'f', 1) << endl;
+        }
+    } else {
+        int nameWidth = groupBy.length();
+        foreach (const Row &row, rows) {
+            nameWidth = qMax(nameWidth, row.name.length());
+        }
+
+        out << groupBy.leftJustified(nameWidth) << "  " << QStringLiteral("time").rightJustified(10) << "  " << QStringLiteral("%").rightJustified(5) << endl;
+        foreach (const Row &row, rows) {
+            out << row.name.leftJustified(nameWidth) << "  "
+                << formatDuration(row.msecs / 1000).rightJustified(10) << "  "
+                << QString::number(totalMsecs ? row.msecs * 100.0 / totalMsecs : 0.0, 'f', 1).rightJustified(5) << endl;
+        }
+        out << QStringLiteral("total").leftJustified(nameWidth) << "  " << formatDuration(totalMsecs / 1000).rightJustified(10) << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitycategorymodel.h"
+#include "activitymodel.h"
+
+#include <QSignalSpy>
+#include <QStandardItemModel>
+#include <QTest>
+
+/*                      ActivityCategoryModelTest                          *
+ * ----------------------------------------------------------------------- */
+
+class ActivityCategoryModelTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testTotals();
+    void testTimeChanged();
+    void testCategoryChanged();
+    void testRowsInsertedAndRemoved();
+
+private:
+    void appendActivity(const QString &name, const QString &category, qint64 seconds);
+    // Category name, seconds, percentual usage and activity count of every row
+    QStringList categories() const;
+
+    QStandardItemModel *source;
+    ActivityCategoryModel *model;
+};
+
+void ActivityCategoryModelTest::init()
+{
+    source = new QStandardItemModel();
+    model = new ActivityCategoryModel();
+}
+
+void ActivityCategoryModelTest::cleanup()
+{
+    delete model;
+    delete source;
+}
+
+void ActivityCategoryModelTest::appendActivity(const QString &name, const QString &category, qint64 seconds)
+{
+    QStandardItem *item = new QStandardItem();
+    item->setData(name, ActivityModel::ActivityNameRole);
+    item->setData(category, ActivityModel::ActivityCategoryRole);
+    item->setData(seconds, ActivityModel::ActivitySecondsRole);
+    source->appendRow(item);
+}
+
+QStringList ActivityCategoryModelTest::categories() const
+{
+    QStringList result;
+
+    for (int row = 0; row < model->rowCount(QModelIndex()); row++) {
+        const QModelIndex index = model->index(row, 0);
+        result << QStringLiteral("%1 %2 %3% %4").arg(index.data(ActivityCategoryModel::CategoryNameRole).toString())
+                                                .arg(index.data(ActivityCategoryModel::CategorySecondsRole).toLongLong())
+                                                .arg(index.data(ActivityCategoryModel::CategoryPercentualUsageRole).toInt())
+                                                .arg(index.data(ActivityCategoryModel::CategoryActivityCountRole).toInt());
+    }
+
+    return result;
+}
+
+void ActivityCategoryModelTest::testTotals()
+{
+    appendActivity(QStringLiteral("konsole"), QStringLiteral("Work"), 300);
+    appendActivity(QStringLiteral("kate"), QStringLiteral("Work"), 300);
+    appendActivity(QStringLiteral("firefox"), QStringLiteral("Browsing"), 200);
+    appendActivity(QStringLiteral("dolphin"), QString(), 200);
+    model->setSourceModel(source);
+
+    QCOMPARE(categories(), QStringList() << QStringLiteral("Work 600 60% 2")
+                                         << QStringLiteral("Browsing 200 20% 1")
+                                         << QStringLiteral("Uncategorized 200 20% 1"));
+}
+
+void ActivityCategoryModelTest::testTimeChanged()
+{
+    appendActivity(QStringLiteral("konsole"), QStringLiteral("Work"), 100);
+    appendActivity(QStringLiteral("firefox"), QStringLiteral("Browsing"), 100);
+    model->setSourceModel(source);
+
+    QSignalSpy spy(model, &QAbstractItemModel::dataChanged);
+    source->item(0)->setData(300, ActivityModel::ActivitySecondsRole);
+
+    // The total changed, so every percentage did
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(categories(), QStringList() << QStringLiteral("Work 300 75% 1") << QStringLiteral("Browsing 100 25% 1"));
+}
+
+void ActivityCategoryModelTest::testCategoryChanged()
+{
+    appendActivity(QStringLiteral("konsole"), QStringLiteral("Work"), 100);
+    appendActivity(QStringLiteral("firefox"), QStringLiteral("Browsing"), 100);
+    model->setSourceModel(source);
+
+    // The last activity of a category leaves it
+    source->item(1)->setData(QStringLiteral("Work"), ActivityModel::ActivityCategoryRole);
+    QCOMPARE(categories(), QStringList() << QStringLiteral("Work 200 100% 2"));
+
+    source->item(0)->setData(QStringLiteral("Terminals"), ActivityModel::ActivityCategoryRole);
+    QCOMPARE(categories(), QStringList() << QStringLiteral("Work 100 50% 1") << QStringLiteral("Terminals 100 50% 1"));
+}
+
+void ActivityCategoryModelTest::testRowsInsertedAndRemoved()
+{
+    model->setSourceModel(source);
+    QCOMPARE(model->rowCount(QModelIndex()), 0);
+
+    appendActivity(QStringLiteral("konsole"), QStringLiteral("Work"), 100);
+    appendActivity(QStringLiteral("firefox"), QStringLiteral("Browsing"), 300);
+    QCOMPARE(categories(), QStringList() << QStringLiteral("Work 100 25% 1") << QStringLiteral("Browsing 300 75% 1"));
+
+    source->removeRow(0);
+    QCOMPARE(categories(), QStringList() << QStringLiteral("Browsing 300 100% 1"));
+}
+
+QTEST_GUILESS_MAIN(ActivityCategoryModelTest)
+
+#include "activitycategorymodeltest.moc"
@@ -0,0 +1,234 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitycheckpoint.h"
+#include "activityhistory.h"
+#include "activitymodel.h"
+#include "fakefocusbackend.h"
+
+#include <KConfigGroup>
+#include <KSharedConfig>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+
+#include <cstdio>
+
+/*                        ActivityCheckpointTest                           *
+ * ----------------------------------------------------------------------- */
+
+class ActivityCheckpointTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void testKilledMidInterval();
+    void testStoppedInterval();
+    void testRecoveredOnce();
+    void testSecondInstance();
+    void testRecoveryIsAccounted();
+
+private:
+    QTemporaryDir m_runtimeDir;
+};
+
+// Runs in a child process which gets killed while it is tracking an activity
+static int killedChild()
+{
+    ActivityCheckpoint checkpoint;
+    checkpoint.setPartition(2, QStringLiteral("work"));
+    checkpoint.startInterval(QStringLiteral("konsole"), 0);
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    bool announced = false;
+
+    forever {
+        QThread::msleep(100);
+        checkpoint.heartbeat();
+
+        if (!announced && elapsed.elapsed() >= 2500) {
+            printf("ready\n");
+            fflush(stdout);
+            announced = true;
+        }
+    }
+
+    return 0;
+}
+
+void ActivityCheckpointTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    // Inherited by the child processes
+    QVERIFY(m_runtimeDir.isValid());
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(m_runtimeDir.path()));
+}
+
+void ActivityCheckpointTest::init()
+{
+    QFile::remove(m_runtimeDir.path() + QStringLiteral("/plasma-timekeeper-checkpoint"));
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/plasma-timekeeper"));
+    QFile::remove(ActivityHistory::defaultPath());
+    QFile::remove(ActivityHistory::defaultPath() + QStringLiteral(".names"));
+    KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig)->reparseConfiguration();
+}
+
+void ActivityCheckpointTest::testKilledMidInterval()
+{
+    QProcess child;
+    child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    child.start(QCoreApplication::applicationFilePath(), QStringList() << QStringLiteral("--killed-child"));
+    QVERIFY(child.waitForStarted());
+    QVERIFY(child.waitForReadyRead(10000));
+    QCOMPARE(child.readLine().trimmed(), QByteArray("ready"));
+
+    // SIGKILL, nothing gets flushed or cleaned up
+    child.kill();
+    QVERIFY(child.waitForFinished());
+    QCOMPARE(child.exitStatus(), QProcess::CrashExit);
+
+    ActivityCheckpoint checkpoint;
+    QVERIFY(checkpoint.isValid());
+
+    ActivityCheckpoint::Interval interval;
+    QVERIFY(checkpoint.recover(&interval));
+    QCOMPARE(interval.configGroup, QStringLiteral("konsole"));
+    QVERIFY(interval.seconds >= 2);
+    QVERIFY(interval.seconds <= 10);
+    QCOMPARE(interval.desktop, 2);
+    QCOMPARE(interval.kdeActivity, QStringLiteral("work"));
+    QVERIFY(qAbs(interval.end.msecsTo(QDateTime::currentDateTimeUtc())) < 5000);
+}
+
+void ActivityCheckpointTest::testStoppedInterval()
+{
+    {
+        ActivityCheckpoint checkpoint;
+        checkpoint.startInterval(QStringLiteral("konsole"), 5000);
+        checkpoint.stopInterval();
+    }
+
+    ActivityCheckpoint checkpoint;
+    ActivityCheckpoint::Interval interval;
+    QVERIFY(!checkpoint.recover(&interval));
+}
+
+void ActivityCheckpointTest::testRecoveredOnce()
+{
+    {
+        ActivityCheckpoint checkpoint;
+        checkpoint.startInterval(QStringLiteral("konsole"), 5000);
+    }
+
+    ActivityCheckpoint::Interval interval;
+    {
+        ActivityCheckpoint checkpoint;
+        QVERIFY(checkpoint.recover(&interval));
+        QCOMPARE(interval.seconds, 5);
+    }
+
+    ActivityCheckpoint checkpoint;
+    QVERIFY(!checkpoint.recover(&interval));
+}
+
+void ActivityCheckpointTest::testSecondInstance()
+{
+    ActivityCheckpoint::Interval interval;
+    {
+        ActivityCheckpoint checkpoint;
+        QVERIFY(checkpoint.isValid());
+        checkpoint.startInterval(QStringLiteral("konsole"), 5000);
+
+        // Must neither take over nor overwrite the interval of the first instance
+        ActivityCheckpoint second;
+        QVERIFY(!second.isValid());
+        QVERIFY(!second.recover(&interval));
+        second.startInterval(QStringLiteral("dolphin"), 7000);
+    }
+
+    ActivityCheckpoint checkpoint;
+    QVERIFY(checkpoint.isValid());
+    QVERIFY(checkpoint.recover(&interval));
+    QCOMPARE(interval.configGroup, QStringLiteral("konsole"));
+    QCOMPARE(interval.seconds, 5);
+}
+
+void ActivityCheckpointTest::testRecoveryIsAccounted()
+{
+    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+    KConfigGroup group(config, QStringLiteral("konsole"));
+    group.writeEntry(QStringLiteral("name"), QStringLiteral("konsole"));
+    group.writeEntry(QStringLiteral("time"), QTime(0, 1, 0).toString(Qt::RFC2822Date));
+    group.writeEntry(QStringLiteral("windowClass"), QStringLiteral("konsole"));
+    config->sync();
+
+    // The previous instance left five seconds behind
+    {
+        ActivityCheckpoint checkpoint;
+        checkpoint.setPartition(3, QStringLiteral("work"));
+        checkpoint.startInterval(QStringLiteral("konsole"), 5000);
+    }
+
+    ActivityModel model(new FakeFocusBackend());
+    QCOMPARE(model.rowCount(QModelIndex()), 1);
+
+    const QModelIndex index = model.index(0, 0);
+    QCOMPARE(model.data(index, ActivityModel::ActivitySecondsRole).toInt(), 65);
+    QCOMPARE(model.partitionSeconds(0, 3, QStringLiteral("work")), qint64(5));
+    QCOMPARE(model.totalActivityTime(), QStringLiteral("00:01:05"));
+
+    // Stored like any other tick
+    config->reparseConfiguration();
+    QCOMPARE(group.readEntry(QStringLiteral("time")), QStringLiteral("00:01:05"));
+    QCOMPARE(group.readEntry(QStringLiteral("partition_3_work"), 0), 5);
+
+    // Written with the next batch
+    QVERIFY(QMetaObject::invokeMethod(&model, "writeHistory"));
+    ActivityHistory history;
+    QVERIFY(history.open());
+    QCOMPARE(history.count(), qint64(1));
+    QCOMPARE(history.intervals()[0].seconds, quint32(5));
+    QCOMPARE(history.activities().value(history.intervals()[0].activity), QStringLiteral("konsole"));
+    QVERIFY(qAbs(QDateTime::currentMSecsSinceEpoch() - 5000 - history.intervals()[0].start) < 5000);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && qstrcmp(argv[1], "--killed-child") == 0) {
+        return killedChild();
+    }
+
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    ActivityCheckpointTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "activitycheckpointtest.moc"
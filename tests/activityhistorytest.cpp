@@ -0,0 +1,212 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityhistory.h"
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QVector>
+
+/*                         ActivityHistoryTest                             *
+ * ----------------------------------------------------------------------- */
+
+class ActivityHistoryTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void testInterleavedWriters();
+    void testBufferedWriterHoldsLock();
+    void testUnterminatedName();
+    void testUsers();
+    void testRefresh();
+    void testLongIntervals();
+
+private:
+    QStringList readBack() const;
+
+    QScopedPointer<QTemporaryDir> dir;
+    QString path;
+};
+
+void ActivityHistoryTest::init()
+{
+    dir.reset(new QTemporaryDir());
+    QVERIFY(dir->isValid());
+    path = dir->path() + QStringLiteral("/history");
+}
+
+QStringList ActivityHistoryTest::readBack() const
+{
+    QStringList result;
+
+    ActivityHistory history(path);
+    if (!history.open()) {
+        return result;
+    }
+
+    const QStringList activities = history.activities();
+    for (qint64 i = 0; i < history.count(); i++) {
+        result << activities.value(history.intervals()[i].activity);
+    }
+
+    return result;
+}
+
+void ActivityHistoryTest::testInterleavedWriters()
+{
+    const QDateTime start = QDateTime::currentDateTimeUtc();
+
+    // Both know nothing about the names added by the other one
+    ActivityHistory first(path);
+    ActivityHistory second(path);
+    QVERIFY(first.append(QStringLiteral("konsole"), start, 1));
+    QVERIFY(second.append(QStringLiteral("firefox"), start.addSecs(1), 1));
+    QVERIFY(first.append(QStringLiteral("firefox"), start.addSecs(2), 1));
+    QVERIFY(second.append(QStringLiteral("konsole"), start.addSecs(3), 1));
+    QVERIFY(first.append(QStringLiteral("dolphin"), start.addSecs(4), 1));
+    QVERIFY(second.append(QStringLiteral("dolphin"), start.addSecs(5), 1));
+
+    QCOMPARE(readBack(), QStringList() << QStringLiteral("konsole") << QStringLiteral("firefox") << QStringLiteral("firefox")
+                                       << QStringLiteral("konsole") << QStringLiteral("dolphin") << QStringLiteral("dolphin"));
+
+    ActivityHistory history(path);
+    QVERIFY(history.open());
+    QCOMPARE(history.activities().count(), 3);
+}
+
+void ActivityHistoryTest::testBufferedWriterHoldsLock()
+{
+    const QDateTime start = QDateTime::currentDateTimeUtc();
+
+    ActivityHistory buffered(path);
+    buffered.setBuffered(true);
+    QVERIFY(buffered.append(QStringLiteral("konsole"), start, 1));
+
+    ActivityHistory other(path);
+    QVERIFY(!other.append(QStringLiteral("firefox"), start.addSecs(1), 1));
+
+    buffered.setBuffered(false);
+    QVERIFY(other.append(QStringLiteral("firefox"), start.addSecs(1), 1));
+
+    QCOMPARE(readBack(), QStringList() << QStringLiteral("konsole") << QStringLiteral("firefox"));
+}
+
+void ActivityHistoryTest::testUnterminatedName()
+{
+    const QDateTime start = QDateTime::currentDateTimeUtc();
+
+    {
+        ActivityHistory history(path);
+        QVERIFY(history.append(QStringLiteral("konsole"), start, 1));
+    }
+
+    // A writer died in the middle of a name
+    QFile names(path + QStringLiteral(".names"));
+    QVERIFY(names.open(QIODevice::WriteOnly | QIODevice::Append));
+    names.write("fire");
+    names.close();
+
+    ActivityHistory history(path);
+    QVERIFY(history.append(QStringLiteral("dolphin"), start.addSecs(1), 1));
+
+    QCOMPARE(readBack(), QStringList() << QStringLiteral("konsole") << QStringLiteral("dolphin"));
+}
+
+void ActivityHistoryTest::testUsers()
+{
+    const QDateTime start = QDateTime::currentDateTimeUtc();
+
+    ActivityHistory writer(path);
+    QVERIFY(writer.append(QStringLiteral("konsole"), start, 1));
+    QVERIFY(writer.append(QStringLiteral("konsole"), start.addSecs(1), 1, QStringLiteral("alice")));
+    QVERIFY(writer.append(QStringLiteral("firefox"), start.addSecs(2), 1, QStringLiteral("bob")));
+    QVERIFY(writer.append(QStringLiteral("dolphin"), start.addSecs(3), 1, QStringLiteral("alice")));
+    writer.close();
+
+    ActivityHistory history(path);
+    QVERIFY(history.open());
+    QCOMPARE(history.users(), QStringList() << QStringLiteral("alice") << QStringLiteral("bob"));
+    QCOMPARE(history.count(), qint64(4));
+    QCOMPARE(history.intervals()[0].user, ActivityHistory::NoUser);
+    QCOMPARE(history.intervals()[1].user, quint32(0));
+    QCOMPARE(history.intervals()[2].user, quint32(1));
+    QCOMPARE(history.intervals()[3].user, quint32(0));
+}
+
+void ActivityHistoryTest::testRefresh()
+{
+    const QDateTime start = QDateTime::currentDateTimeUtc();
+
+    ActivityHistory writer(path);
+    QVERIFY(writer.append(QStringLiteral("konsole"), start, 1));
+
+    ActivityHistory reader(path);
+    QVERIFY(reader.open());
+    QVERIFY(!reader.refresh());
+
+    QVERIFY(writer.append(QStringLiteral("firefox"), start.addSecs(1), 7200));
+    bool reopened = true;
+    QVERIFY(reader.refresh(&reopened));
+    QVERIFY(!reopened);
+    QCOMPARE(reader.count(), qint64(2));
+    QCOMPARE(reader.activities(), QStringList() << QStringLiteral("konsole") << QStringLiteral("firefox"));
+    QCOMPARE(reader.maximumSeconds(), quint32(7200));
+
+    // A merge replaces the history as a whole
+    QVERIFY(QFile::remove(path));
+    QVERIFY(QFile::remove(path + QStringLiteral(".names")));
+    ActivityHistory replacement(path);
+    QVERIFY(replacement.append(QStringLiteral("dolphin"), start, 1));
+
+    QVERIFY(reader.refresh(&reopened));
+    QVERIFY(reopened);
+    QCOMPARE(reader.count(), qint64(1));
+    QCOMPARE(reader.activities(), QStringList() << QStringLiteral("dolphin"));
+}
+
+void ActivityHistoryTest::testLongIntervals()
+{
+    const QDateTime start = QDateTime::currentDateTimeUtc().addDays(-1);
+
+    ActivityHistory writer(path);
+    QVERIFY(writer.append(QStringLiteral("konsole"), start, 10 * 3600));
+    QVERIFY(writer.append(QStringLiteral("firefox"), start.addSecs(60), 3 * 3600));
+    for (int i = 0; i < 100; i++) {
+        QVERIFY(writer.append(QStringLiteral("dolphin"), start.addSecs(3600 + i * 300), 60));
+    }
+
+    ActivityHistory history(path);
+    QVERIFY(history.open());
+
+    // Only the short intervals of the last hour before the range are scanned
+    const qint64 from = start.addSecs(5 * 3600).toMSecsSinceEpoch();
+    QVector<qint64> earlier;
+    const qint64 first = history.firstIntersecting(from, &earlier);
+
+    QCOMPARE(earlier, QVector<qint64>() << 0);
+    QCOMPARE(first, history.lowerBound(from - qint64(ActivityHistory::LongIntervalSeconds) * 1000));
+}
+
+QTEST_GUILESS_MAIN(ActivityHistoryTest)
+
+#include "activityhistorytest.moc"
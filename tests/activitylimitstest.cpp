@@ -0,0 +1,119 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitylimits.h"
+#include "timekeeperclock.h"
+
+#include <QSignalSpy>
+#include <QTest>
+
+/*                          ActivityLimitsTest                             *
+ * ----------------------------------------------------------------------- */
+
+// The limits are checked by calling the timer slot right away, the clock is
+// moved forward instead of waiting for the timer
+class ActivityLimitsTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void testThreshold();
+    void testMidnight();
+
+private:
+    void advanceTo(const QTime &time);
+    void check(ActivityLimits *limits);
+};
+
+void ActivityLimitsTest::advanceTo(const QTime &time)
+{
+    const QDateTime now = TimekeeperClock::currentDateTime();
+    QDateTime next(now.date(), time);
+    if (next <= now) {
+        next = next.addDays(1);
+    }
+    TimekeeperClock::advance(now.msecsTo(next));
+}
+
+void ActivityLimitsTest::check(ActivityLimits *limits)
+{
+    QVERIFY(QMetaObject::invokeMethod(limits, "deadlineReached"));
+}
+
+void ActivityLimitsTest::testThreshold()
+{
+    advanceTo(QTime(12, 0));
+
+    ActivityLimits limits;
+    QSignalSpy spy(&limits, &ActivityLimits::limitReached);
+    limits.setLimits(QStringList() << QStringLiteral("konsole = 1") << QStringLiteral("@Development = 2"));
+    limits.setCurrentActivity(QStringLiteral("konsole"), QStringLiteral("Development"));
+
+    TimekeeperClock::advance(30000);
+    limits.addUsage(QStringLiteral("konsole"), QStringLiteral("Development"), 30);
+    check(&limits);
+    QCOMPARE(spy.count(), 0);
+
+    // Reported and pending time add up
+    TimekeeperClock::advance(31000);
+    check(&limits);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toString(), QStringLiteral("konsole"));
+    QCOMPARE(spy.at(0).at(1).toInt(), 1);
+
+    // Fires once per day
+    TimekeeperClock::advance(30000);
+    check(&limits);
+    QCOMPARE(spy.count(), 1);
+
+    TimekeeperClock::advance(30000);
+    check(&limits);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(0).toString(), QStringLiteral("@Development"));
+    QCOMPARE(spy.at(1).at(1).toInt(), 2);
+}
+
+void ActivityLimitsTest::testMidnight()
+{
+    advanceTo(QTime(23, 59));
+
+    ActivityLimits limits;
+    QSignalSpy spy(&limits, &ActivityLimits::limitReached);
+    limits.setLimits(QStringList() << QStringLiteral("konsole = 1"));
+    limits.setCurrentActivity(QStringLiteral("konsole"), QString());
+    limits.addUsage(QStringLiteral("konsole"), QString(), 50);
+
+    // Neither the usage nor the running interval before midnight count for the new day
+    TimekeeperClock::advance(90000);
+    check(&limits);
+    QCOMPARE(spy.count(), 0);
+
+    TimekeeperClock::advance(20000);
+    check(&limits);
+    QCOMPARE(spy.count(), 0);
+
+    TimekeeperClock::advance(20000);
+    check(&limits);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toString(), QStringLiteral("konsole"));
+}
+
+QTEST_GUILESS_MAIN(ActivityLimitsTest)
+
+#include "activitylimitstest.moc"
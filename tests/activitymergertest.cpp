@@ -0,0 +1,180 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityexport.h"
+#include "activityhistory.h"
+#include "activitymerger.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QVector>
+
+#include <algorithm>
+
+static const int USER_COUNT = 100;
+static const int HOSTS_PER_USER = 3;
+static const int INTERVALS_PER_USER = 60;
+
+/*                          ActivityMergerTest                             *
+ * ----------------------------------------------------------------------- */
+
+class ActivityMergerTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void testManyExports();
+    void testFailureKeepsOutput();
+
+private:
+    static qint64 intervalStart(int user, int interval);
+    static quint32 intervalSeconds(int interval);
+
+    // One export per user and host, the intervals of a user alternate between
+    // their hosts. Exports of odd users are written backwards.
+    QStringList writeExports();
+
+    QScopedPointer<QTemporaryDir> dir;
+};
+
+void ActivityMergerTest::init()
+{
+    dir.reset(new QTemporaryDir());
+    QVERIFY(dir->isValid());
+}
+
+qint64 ActivityMergerTest::intervalStart(int user, int interval)
+{
+    // Users overlap each other, the intervals of one user don't
+    return Q_INT64_C(1500000000000) + user * 7000 + interval * 60000;
+}
+
+quint32 ActivityMergerTest::intervalSeconds(int interval)
+{
+    return 10 + interval % 7;
+}
+
+QStringList ActivityMergerTest::writeExports()
+{
+    QStringList paths;
+
+    for (int user = 0; user < USER_COUNT; user++) {
+        for (int host = 0; host < HOSTS_PER_USER; host++) {
+            QVector<ActivityExportRecord> records;
+            for (int interval = host; interval < INTERVALS_PER_USER; interval += HOSTS_PER_USER) {
+                ActivityExportRecord record;
+                record.start = intervalStart(user, interval);
+                record.seconds = intervalSeconds(interval);
+                record.activity = QStringLiteral("activity%1").arg(interval % 10);
+                records << record;
+            }
+
+            if (user % 2) {
+                std::reverse(records.begin(), records.end());
+            }
+
+            const QString path = dir->path() + QStringLiteral("/export-%1-%2").arg(user).arg(host);
+            ActivityExportWriter writer;
+            if (!writer.open(path, QStringLiteral("user%1").arg(user), QStringLiteral("host%1").arg(host))) {
+                return QStringList();
+            }
+            foreach (const ActivityExportRecord &record, records) {
+                writer.write(record);
+            }
+            paths << path;
+        }
+    }
+
+    return paths;
+}
+
+void ActivityMergerTest::testManyExports()
+{
+    QStringList exports = writeExports();
+    QCOMPARE(exports.count(), USER_COUNT * HOSTS_PER_USER);
+
+    // Merged twice by accident
+    exports << exports.first();
+
+    const QString output = dir->path() + QStringLiteral("/merged");
+    ActivityMerger merger;
+    QVERIFY2(merger.merge(exports, output), qPrintable(merger.errorString()));
+
+    QCOMPARE(merger.merged(), qint64(USER_COUNT * INTERVALS_PER_USER));
+    QCOMPARE(merger.trimmed(), qint64(INTERVALS_PER_USER / HOSTS_PER_USER));
+    QCOMPARE(merger.sortedExports(), USER_COUNT / 2 * HOSTS_PER_USER);
+
+    ActivityHistory history(output);
+    QVERIFY(history.open());
+    QCOMPARE(history.count(), qint64(USER_COUNT * INTERVALS_PER_USER));
+    QCOMPARE(history.users().count(), USER_COUNT);
+    QCOMPARE(history.activities().count(), 10);
+
+    QHash<QString, qint64> userSeconds;
+    const ActivityHistory::Interval *intervals = history.intervals();
+    for (qint64 i = 0; i < history.count(); i++) {
+        if (i > 0) {
+            QVERIFY(intervals[i - 1].start <= intervals[i].start);
+        }
+        QVERIFY(intervals[i].user != ActivityHistory::NoUser);
+        userSeconds[history.users().at(intervals[i].user)] += intervals[i].seconds;
+    }
+
+    qint64 expectedSeconds = 0;
+    for (int interval = 0; interval < INTERVALS_PER_USER; interval++) {
+        expectedSeconds += intervalSeconds(interval);
+    }
+
+    QCOMPARE(userSeconds.count(), USER_COUNT);
+    for (int user = 0; user < USER_COUNT; user++) {
+        QCOMPARE(userSeconds.value(QStringLiteral("user%1").arg(user)), expectedSeconds);
+    }
+}
+
+void ActivityMergerTest::testFailureKeepsOutput()
+{
+    const QStringList exports = writeExports();
+
+    const QString output = dir->path() + QStringLiteral("/merged");
+    ActivityMerger merger;
+    QVERIFY(merger.merge(exports.mid(0, 3), output));
+
+    QFile outputFile(output);
+    QVERIFY(outputFile.open(QIODevice::ReadOnly));
+    const QByteArray contents = outputFile.readAll();
+    outputFile.close();
+
+    QVERIFY(!merger.merge(QStringList() << exports << dir->path() + QStringLiteral("/missing"), output));
+    QVERIFY(!merger.errorString().isEmpty());
+
+    QVERIFY(outputFile.open(QIODevice::ReadOnly));
+    QCOMPARE(outputFile.readAll(), contents);
+
+    // No temporary files left behind
+    QCOMPARE(QDir(dir->path()).entryList(QStringList() << QStringLiteral("merged*"), QDir::Files).count(), 3);
+}
+
+QTEST_GUILESS_MAIN(ActivityMergerTest)
+
+#include "activitymergertest.moc"
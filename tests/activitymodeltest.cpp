@@ -0,0 +1,235 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityhistory.h"
+#include "activitymodel.h"
+#include "activityrules.h"
+#include "fakefocusbackend.h"
+#include "timekeeperclock.h"
+
+#include <KConfigGroup>
+#include <KSharedConfig>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QLockFile>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+/*                          ActivityModelTest                              *
+ * ----------------------------------------------------------------------- */
+
+class ActivityModelTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void testLateResolvedWindowKeepsHistoryOrder();
+    void testRemovedPendingWindowReleasesHistory();
+    void testBusyHistoryRetried();
+    void testIgnoredActivityBecomesRule();
+    void testLegacyIgnoredActivitiesMigrated();
+
+private:
+    // Writes what the model queued, like its history timer does, and reads it back
+    QStringList historyActivities(ActivityModel *model) const;
+
+    QTemporaryDir m_runtimeDir;
+};
+
+void ActivityModelTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    QVERIFY(m_runtimeDir.isValid());
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(m_runtimeDir.path()));
+}
+
+void ActivityModelTest::init()
+{
+    QFile::remove(m_runtimeDir.path() + QStringLiteral("/plasma-timekeeper-checkpoint"));
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/plasma-timekeeper"));
+    QFile::remove(ActivityHistory::defaultPath());
+    QFile::remove(ActivityHistory::defaultPath() + QStringLiteral(".names"));
+    KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig)->reparseConfiguration();
+}
+
+QStringList ActivityModelTest::historyActivities(ActivityModel *model) const
+{
+    QStringList result;
+
+    if (!QMetaObject::invokeMethod(model, "writeHistory")) {
+        return result;
+    }
+
+    ActivityHistory history;
+    if (!history.open()) {
+        return result;
+    }
+
+    const QStringList activities = history.activities();
+    for (qint64 i = 0; i < history.count(); i++) {
+        // Sorted by start, which lowerBound() and every reader rely on
+        if (i > 0 && history.intervals()[i].start < history.intervals()[i - 1].start) {
+            return QStringList() << QStringLiteral("unsorted");
+        }
+        result << QStringLiteral("%1 %2").arg(activities.value(history.intervals()[i].activity)).arg(history.intervals()[i].seconds);
+    }
+
+    return result;
+}
+
+void ActivityModelTest::testLateResolvedWindowKeepsHistoryOrder()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    backend->addWindow(1, QStringLiteral("konsole"));
+    backend->addWindow(2, QStringLiteral("firefox"), false);
+    backend->addWindow(3, QStringLiteral("dolphin"));
+
+    ActivityModel model(backend);
+
+    backend->setActiveWindow(1);
+    TimekeeperClock::advance(10000);
+
+    // Firefox gets focus before its class is known and loses it again
+    backend->setActiveWindow(2);
+    TimekeeperClock::advance(20000);
+    backend->setActiveWindow(1);
+    TimekeeperClock::advance(40000);
+    backend->setActiveWindow(3);
+
+    // Konsole used after firefox waits for it
+    QCOMPARE(historyActivities(&model), QStringList() << QStringLiteral("konsole 10"));
+
+    backend->resolveWindow(2);
+    QCOMPARE(historyActivities(&model), QStringList() << QStringLiteral("konsole 10") << QStringLiteral("firefox 20") << QStringLiteral("konsole 40"));
+}
+
+void ActivityModelTest::testRemovedPendingWindowReleasesHistory()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    backend->addWindow(1, QStringLiteral("konsole"));
+    backend->addWindow(2, QStringLiteral("firefox"), false);
+    backend->addWindow(3, QStringLiteral("dolphin"));
+
+    ActivityModel model(backend);
+
+    backend->setActiveWindow(2);
+    TimekeeperClock::advance(20000);
+    backend->setActiveWindow(1);
+    TimekeeperClock::advance(40000);
+    backend->setActiveWindow(3);
+    QCOMPARE(historyActivities(&model), QStringList());
+
+    // Closed before we knew its class, its time is dropped
+    backend->removeWindow(2);
+    QCOMPARE(historyActivities(&model), QStringList() << QStringLiteral("konsole 40"));
+}
+
+void ActivityModelTest::testBusyHistoryRetried()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    backend->addWindow(1, QStringLiteral("konsole"));
+    backend->addWindow(2, QStringLiteral("dolphin"));
+
+    ActivityModel model(backend);
+
+    backend->setActiveWindow(1);
+    TimekeeperClock::advance(10000);
+    backend->setActiveWindow(2);
+
+    // Another writer, e.g. the merge tool, holds the history
+    QLockFile lock(ActivityHistory::defaultPath() + QStringLiteral(".lock"));
+    QVERIFY(lock.tryLock(0));
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QVERIFY(QMetaObject::invokeMethod(&model, "writeHistory"));
+    QVERIFY(elapsed.elapsed() < 500);
+    ActivityHistory history;
+    QVERIFY(!history.open() || history.count() == 0);
+
+    TimekeeperClock::advance(20000);
+    backend->setActiveWindow(1);
+
+    // Everything queued meanwhile is written on the next try
+    lock.unlock();
+    QCOMPARE(historyActivities(&model), QStringList() << QStringLiteral("konsole 10") << QStringLiteral("dolphin 20"));
+}
+
+void ActivityModelTest::testIgnoredActivityBecomesRule()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    backend->addWindow(1, QStringLiteral("konsole"));
+
+    ActivityModel model(backend);
+    model.setActivityRules(QStringList() << QStringLiteral("category exact konsole Terminals"));
+    backend->setActiveWindow(1);
+
+    QSignalSpy spy(&model, &ActivityModel::activityRulesChanged);
+    model.ignoreActivity(QStringLiteral("konsole"));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(model.activityRules(), QStringList() << QStringLiteral("category exact konsole Terminals") << QStringLiteral("ignore exact konsole"));
+    QCOMPARE(model.currentActivityName(), QStringLiteral("other applications"));
+
+    // Without the rule it is tracked on its own again
+    model.setActivityRules(QStringList() << QStringLiteral("category exact konsole Terminals"));
+    backend->addWindow(2, QStringLiteral("konsole"));
+    backend->setActiveWindow(2);
+    QCOMPARE(model.currentActivityName(), QStringLiteral("konsole"));
+    QCOMPARE(spy.count(), 1);
+}
+
+void ActivityModelTest::testLegacyIgnoredActivitiesMigrated()
+{
+    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+    KConfigGroup generalGroup(config, QStringLiteral("general"));
+    generalGroup.writeEntry(QStringLiteral("ignoredActivities"), QStringList() << QStringLiteral("firefox") << QStringLiteral("Media Player"));
+    config->sync();
+
+    ActivityModel model(new FakeFocusBackend());
+
+    QSignalSpy spy(&model, &ActivityModel::activityRulesChanged);
+    model.setActivityRules(QStringList() << QString());
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(model.activityRules(), QStringList() << QStringLiteral("ignore exact firefox") << ActivityRules::ignoreRule(QStringLiteral("Media Player")));
+
+    config->reparseConfiguration();
+    QVERIFY(!generalGroup.hasKey(QStringLiteral("ignoredActivities")));
+
+    // Stored rules come back unchanged
+    model.setActivityRules(model.activityRules());
+    QCOMPARE(spy.count(), 1);
+}
+
+int main(int argc, char **argv)
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    ActivityModelTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "activitymodeltest.moc"
@@ -0,0 +1,162 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityrules.h"
+
+#include <QTest>
+
+/*                       ActivityRulesBenchmark                            *
+ * ----------------------------------------------------------------------- */
+
+class ActivityRulesBenchmark : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void benchmarkCompile_data();
+    void benchmarkCompile();
+    void benchmarkMatch_data();
+    void benchmarkMatch();
+    void benchmarkCachedMatch_data();
+    void benchmarkCachedMatch();
+
+private:
+    static QStringList makeRules(int count);
+    void addData();
+
+    QStringList m_windowClasses;
+};
+
+// A third of the rules of each syntax, spread over all actions
+QStringList ActivityRulesBenchmark::makeRules(int count)
+{
+    static const char *const actions[] = {"ignore", "rename", "category"};
+
+    QStringList rules;
+    for (int i = 0; i < count; i++) {
+        const QString action = QLatin1String(actions[i % 3]);
+        switch ((i / 3) % 3) {
+        case 0:
+            rules << QStringLiteral("%1 exact app%2 Value%2").arg(action).arg(i);
+            break;
+        case 1:
+            rules << QStringLiteral("%1 glob org.vendor%2.* Value%2").arg(action).arg(i);
+            break;
+        default:
+            rules << QStringLiteral("%1 regex [a-z]+-tool%2 Value%2").arg(action).arg(i);
+            break;
+        }
+    }
+
+    return rules;
+}
+
+void ActivityRulesBenchmark::initTestCase()
+{
+    // Mix of classes matching some rule and classes matching none
+    for (int i = 0; i < 1000; i++) {
+        switch (i % 4) {
+        case 0:
+            m_windowClasses << QStringLiteral("app%1").arg(i);
+            break;
+        case 1:
+            m_windowClasses << QStringLiteral("org.vendor%1.viewer").arg(i);
+            break;
+        case 2:
+            m_windowClasses << QStringLiteral("some-tool%1").arg(i);
+            break;
+        default:
+            m_windowClasses << QStringLiteral("unmatched.application.%1").arg(i);
+            break;
+        }
+    }
+}
+
+void ActivityRulesBenchmark::addData()
+{
+    QTest::addColumn<int>("ruleCount");
+
+    QTest::newRow("10 rules") << 10;
+    QTest::newRow("100 rules") << 100;
+    QTest::newRow("1000 rules") << 1000;
+}
+
+void ActivityRulesBenchmark::benchmarkCompile_data()
+{
+    addData();
+}
+
+void ActivityRulesBenchmark::benchmarkCompile()
+{
+    QFETCH(int, ruleCount);
+
+    const QStringList lines = makeRules(ruleCount);
+
+    QBENCHMARK {
+        ActivityRules rules;
+        rules.setRules(lines);
+    }
+}
+
+void ActivityRulesBenchmark::benchmarkMatch_data()
+{
+    addData();
+}
+
+void ActivityRulesBenchmark::benchmarkMatch()
+{
+    QFETCH(int, ruleCount);
+
+    ActivityRules rules;
+    rules.setRules(makeRules(ruleCount));
+
+    QBENCHMARK {
+        rules.clearCache();
+        foreach (const QString &windowClass, m_windowClasses) {
+            rules.match(windowClass);
+        }
+    }
+}
+
+void ActivityRulesBenchmark::benchmarkCachedMatch_data()
+{
+    addData();
+}
+
+void ActivityRulesBenchmark::benchmarkCachedMatch()
+{
+    QFETCH(int, ruleCount);
+
+    ActivityRules rules;
+    rules.setRules(makeRules(ruleCount));
+    foreach (const QString &windowClass, m_windowClasses) {
+        rules.match(windowClass);
+    }
+
+    QBENCHMARK {
+        foreach (const QString &windowClass, m_windowClasses) {
+            rules.match(windowClass);
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(ActivityRulesBenchmark)
+
+#include "activityrulesbenchmark.moc"
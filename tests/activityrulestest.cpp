@@ -0,0 +1,146 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityrules.h"
+
+#include <QTest>
+
+/*                          ActivityRulesTest                              *
+ * ----------------------------------------------------------------------- */
+
+class ActivityRulesTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void testSyntaxes_data();
+    void testSyntaxes();
+    void testFirstRuleWins();
+    void testBackreferences();
+    void testNamedGroups();
+    void testCategoryOfRenamed();
+    void testIgnoredActivities();
+};
+
+void ActivityRulesTest::testSyntaxes_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<QString>("windowClass");
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("exact") << "rename exact konsole Terminal" << "konsole" << "Terminal";
+    QTest::newRow("exact mismatch") << "rename exact konsole Terminal" << "konsole2" << "konsole2";
+    QTest::newRow("glob") << "rename glob org.kde.* KDE" << "org.kde.dolphin" << "KDE";
+    QTest::newRow("glob brackets") << "rename glob xterm[0-9] Terminal" << "xterm5" << "Terminal";
+    QTest::newRow("glob anchored") << "rename glob kde* KDE" << "org.kde" << "org.kde";
+    QTest::newRow("regex") << "rename regex .*-terminal Terminal" << "gnome-terminal" << "Terminal";
+    QTest::newRow("regex anchored") << "rename regex term Terminal" << "xterm" << "xterm";
+    QTest::newRow("value with spaces") << "rename exact vlc Media Player" << "vlc" << "Media Player";
+}
+
+void ActivityRulesTest::testSyntaxes()
+{
+    QFETCH(QString, rule);
+    QFETCH(QString, windowClass);
+    QFETCH(QString, name);
+
+    ActivityRules rules;
+    rules.setRules(QStringList() << rule);
+
+    QCOMPARE(rules.match(windowClass).name, name);
+}
+
+void ActivityRulesTest::testFirstRuleWins()
+{
+    ActivityRules rules;
+    rules.setRules(QStringList() << QStringLiteral("rename regex (f)\\1 First")
+                                 << QStringLiteral("rename exact ff Second")
+                                 << QStringLiteral("rename glob f* Third")
+                                 << QStringLiteral("rename regex (x)\\1 Fourth"));
+
+    QCOMPARE(rules.match(QStringLiteral("ff")).name, QStringLiteral("First"));
+    QCOMPARE(rules.match(QStringLiteral("fx")).name, QStringLiteral("Third"));
+    QCOMPARE(rules.match(QStringLiteral("xx")).name, QStringLiteral("Fourth"));
+}
+
+void ActivityRulesTest::testBackreferences()
+{
+    ActivityRules rules;
+    rules.setRules(QStringList() << QStringLiteral("rename regex (x)y.* Other")
+                                 << QStringLiteral("rename regex (a+)b\\1 Repeated")
+                                 << QStringLiteral("rename regex (?<part>c+)d\\k<part> Named"));
+
+    QCOMPARE(rules.match(QStringLiteral("aabaa")).name, QStringLiteral("Repeated"));
+    QCOMPARE(rules.match(QStringLiteral("aaba")).name, QStringLiteral("aaba"));
+    QCOMPARE(rules.match(QStringLiteral("ccdcc")).name, QStringLiteral("Named"));
+    QCOMPARE(rules.match(QStringLiteral("ccdc")).name, QStringLiteral("ccdc"));
+    QCOMPARE(rules.match(QStringLiteral("xyz")).name, QStringLiteral("Other"));
+}
+
+void ActivityRulesTest::testNamedGroups()
+{
+    // The group names of the user must not clash with the ones of the matcher
+    ActivityRules rules;
+    rules.setRules(QStringList() << QStringLiteral("category regex (?<r1>foo)bar Development")
+                                 << QStringLiteral("category regex .*baz Other")
+                                 << QStringLiteral("category regex (?<=q)x Never"));
+
+    QCOMPARE(rules.match(QStringLiteral("foobar")).category, QStringLiteral("Development"));
+    QCOMPARE(rules.match(QStringLiteral("foobaz")).category, QStringLiteral("Other"));
+    QCOMPARE(rules.match(QStringLiteral("qx")).category, QString());
+}
+
+void ActivityRulesTest::testCategoryOfRenamed()
+{
+    ActivityRules rules;
+    rules.setRules(QStringList() << QStringLiteral("rename exact konsole Terminal")
+                                 << QStringLiteral("category exact Terminal Development"));
+
+    const ActivityRules::Result result = rules.match(QStringLiteral("konsole"));
+    QCOMPARE(result.name, QStringLiteral("Terminal"));
+    QCOMPARE(result.category, QStringLiteral("Development"));
+}
+
+void ActivityRulesTest::testIgnoredActivities()
+{
+    ActivityRules rules;
+    rules.setRules(QStringList() << QStringLiteral("ignore glob plasma*")
+                                 << QStringLiteral("rename exact konsole Terminal"));
+
+    QVERIFY(rules.match(QStringLiteral("plasmashell")).ignored);
+    QVERIFY(!rules.match(QStringLiteral("konsole")).ignored);
+
+    // Ignored from the applet, renamed activities are ignored under their new name
+    rules.setRules(rules.rules() << ActivityRules::ignoreRule(QStringLiteral("Terminal")));
+    QVERIFY(rules.match(QStringLiteral("konsole")).ignored);
+
+    // Names with spaces can't be a single exact pattern
+    const QString rule = ActivityRules::ignoreRule(QStringLiteral("Media Player"));
+    rules.setRules(QStringList() << QStringLiteral("rename exact vlc Media Player") << rule);
+    QVERIFY(rules.match(QStringLiteral("vlc")).ignored);
+    QVERIFY(!rules.match(QStringLiteral("Media  Player")).ignored);
+
+    // Removing the rule tracks the activity again
+    rules.setRules(QStringList() << QStringLiteral("rename exact vlc Media Player"));
+    QVERIFY(!rules.match(QStringLiteral("vlc")).ignored);
+}
+
+QTEST_GUILESS_MAIN(ActivityRulesTest)
+
+#include "activityrulestest.moc"
@@ -0,0 +1,245 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityhistory.h"
+#include "activitymodel.h"
+#include "fakefocusbackend.h"
+#include "timekeeperclock.h"
+
+#include <KSharedConfig>
+
+#include <QAtomicInteger>
+#include <QFile>
+#include <QGuiApplication>
+#include <QPixmap>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QVector>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <unistd.h>
+
+// Allocations through operator new, Qt containers allocate with malloc and only show up in the RSS
+static QAtomicInteger<qint64> s_liveAllocations;
+static QAtomicInteger<qint64> s_totalAllocations;
+
+void *operator new(std::size_t size)
+{
+    void *pointer = std::malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+
+    s_liveAllocations.ref();
+    s_totalAllocations.ref();
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    if (pointer) {
+        s_liveAllocations.deref();
+        std::free(pointer);
+    }
+}
+
+// Simulated session, all windows of a day get focus during eight hours in slots of five minutes
+static const int SIMULATED_DAYS = 28;
+static const int SLOTS_PER_DAY = 8 * 12;
+static const int TICKS_PER_SLOT = 5;
+static const int REGULAR_CLASSES = 20;
+// Every fourth slot goes to an application never seen before
+static const int NEW_CLASS_SLOT_INTERVAL = 4;
+static const int NEW_CLASSES_PER_DAY = SLOTS_PER_DAY / NEW_CLASS_SLOT_INTERVAL;
+static const int ARCHIVE_AFTER_DAYS = 3;
+static const int MAXIMUM_ICON_COUNT = 16;
+
+// Growth allowed between the second and the last week
+static const qint64 RSS_GROWTH_LIMIT = 4 * 1024 * 1024;
+static const qint64 ALLOCATION_GROWTH_LIMIT = 2000;
+
+/*                          ActivitySoakTest                               *
+ * ----------------------------------------------------------------------- */
+
+class ActivitySoakTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void testLongSession();
+
+private:
+    struct Sample {
+        int day;
+        qint64 rss;
+        qint64 liveAllocations;
+        qint64 totalAllocations;
+        int items;
+    };
+
+    static qint64 residentSetSize();
+    void tick(ActivityModel *model, int seconds);
+
+    QTemporaryDir m_runtimeDir;
+};
+
+void ActivitySoakTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    QVERIFY(m_runtimeDir.isValid());
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(m_runtimeDir.path()));
+
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/plasma-timekeeper"));
+    QFile::remove(ActivityHistory::defaultPath());
+    QFile::remove(ActivityHistory::defaultPath() + QStringLiteral(".names"));
+    KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig)->reparseConfiguration();
+}
+
+qint64 ActivitySoakTest::residentSetSize()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+}
+
+void ActivitySoakTest::tick(ActivityModel *model, int seconds)
+{
+    TimekeeperClock::advance(seconds * 1000);
+    QMetaObject::invokeMethod(model, "updateCurrentActivityTime");
+    // The history timer fires every minute of real time, which never passes here
+    QMetaObject::invokeMethod(model, "writeHistory");
+}
+
+void ActivitySoakTest::testLongSession()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    ActivityModel model(backend);
+    model.setArchiveAfterDays(ARCHIVE_AFTER_DAYS);
+    model.setMaximumIconCount(MAXIMUM_ICON_COUNT);
+
+    QPixmap icon(64, 64);
+    icon.fill(Qt::darkCyan);
+
+    QVector<Sample> samples;
+    WId nextWindow = 1;
+    WId previousWindow = 0;
+
+    for (int day = 1; day <= SIMULATED_DAYS; day++) {
+        for (int slot = 0; slot < SLOTS_PER_DAY; slot++) {
+            const QString windowClass = slot % NEW_CLASS_SLOT_INTERVAL == 0
+                ? QStringLiteral("new-%1-%2").arg(day).arg(slot)
+                : QStringLiteral("regular-%1").arg((slot * 7 + day) % REGULAR_CLASSES);
+
+            // Every window is a new one, as if its title changed, some are slow to tell their class
+            const WId window = nextWindow++;
+            const bool slow = slot % 3 == 0;
+            backend->addWindow(window, windowClass, !slow);
+            backend->setWindowIcon(window, icon);
+            backend->setActiveWindow(window);
+
+            if (previousWindow) {
+                backend->removeWindow(previousWindow);
+            }
+            previousWindow = window;
+
+            for (int i = 0; i < TICKS_PER_SLOT; i++) {
+                tick(&model, 60);
+
+                if (slow && i == 0) {
+                    // A few of them are gone before that
+                    if (slot % 9 == 0) {
+                        backend->removeWindow(window);
+                        previousWindow = 0;
+                    } else {
+                        backend->resolveWindow(window);
+                    }
+                }
+            }
+
+            if (slot % 12 == 11) {
+                QMetaObject::invokeMethod(&model, "archiveUnusedActivities");
+            }
+        }
+
+        // Night
+        backend->setActiveWindow(0);
+        tick(&model, 16 * 3600);
+        QMetaObject::invokeMethod(&model, "archiveUnusedActivities");
+
+        if (day % 7 == 0) {
+            model.resetTimeStatistics();
+        }
+
+        // Archived items are deleted later
+        QCoreApplication::sendPostedEvents(0, QEvent::DeferredDelete);
+
+        Sample sample;
+        sample.day = day;
+        sample.rss = residentSetSize();
+        sample.liveAllocations = s_liveAllocations.load();
+        sample.totalAllocations = s_totalAllocations.load();
+        sample.items = model.rowCount(QModelIndex());
+        samples << sample;
+
+        printf("day %2d: rss %6lld KiB, live allocations %8lld, allocations %10lld, items %4d, windows %d\n",
+               day, sample.rss / 1024, sample.liveAllocations, sample.totalAllocations, sample.items, backend->windowCount());
+        fflush(stdout);
+
+        // Regular applications and the new ones not archived yet
+        QVERIFY2(sample.items <= REGULAR_CLASSES + (ARCHIVE_AFTER_DAYS + 1) * NEW_CLASSES_PER_DAY,
+                 qPrintable(QStringLiteral("%1 items on day %2").arg(sample.items).arg(day)));
+        QVERIFY(backend->windowCount() <= 1);
+    }
+
+    // Both samples right after a reset, everything after it should be steady
+    const Sample &steady = samples.at(13);
+    const Sample &last = samples.last();
+
+    QVERIFY2(last.rss - steady.rss <= RSS_GROWTH_LIMIT,
+             qPrintable(QStringLiteral("RSS grew by %1 KiB").arg((last.rss - steady.rss) / 1024)));
+    QVERIFY2(last.liveAllocations - steady.liveAllocations <= ALLOCATION_GROWTH_LIMIT,
+             qPrintable(QStringLiteral("%1 more live allocations").arg(last.liveAllocations - steady.liveAllocations)));
+
+    // Allocations per week shouldn't grow either
+    const qint64 secondWeek = samples.at(13).totalAllocations - samples.at(6).totalAllocations;
+    const qint64 lastWeek = last.totalAllocations - samples.at(SIMULATED_DAYS - 8).totalAllocations;
+    QVERIFY2(lastWeek <= secondWeek + secondWeek / 10,
+             qPrintable(QStringLiteral("%1 allocations in the last week, %2 in the second one").arg(lastWeek).arg(secondWeek)));
+}
+
+int main(int argc, char **argv)
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    ActivitySoakTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "activitysoaktest.moc"
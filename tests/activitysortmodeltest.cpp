@@ -0,0 +1,169 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitymodel.h"
+#include "activitysortmodel.h"
+
+#include <QCoreApplication>
+#include <QStandardItemModel>
+#include <QTest>
+
+/*                        ActivitySortModelTest                            *
+ * ----------------------------------------------------------------------- */
+
+class ActivitySortModelTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testMaximumCount();
+    void testMinimumSeconds();
+    void testBoundaryCrossed();
+    void testRowsInsertedAndRemoved();
+    void testRenamed();
+
+private:
+    void appendActivity(const QString &name, qint64 seconds);
+    void setSeconds(int row, qint64 seconds);
+    QStringList shown() const;
+
+    QStandardItemModel *source;
+    ActivitySortModel *model;
+};
+
+void ActivitySortModelTest::init()
+{
+    source = new QStandardItemModel();
+    model = new ActivitySortModel();
+}
+
+void ActivitySortModelTest::cleanup()
+{
+    delete model;
+    delete source;
+}
+
+void ActivitySortModelTest::appendActivity(const QString &name, qint64 seconds)
+{
+    QStandardItem *item = new QStandardItem();
+    item->setData(name, ActivityModel::ActivityNameRole);
+    item->setData(seconds, ActivityModel::ActivitySecondsRole);
+    source->appendRow(item);
+}
+
+void ActivitySortModelTest::setSeconds(int row, qint64 seconds)
+{
+    source->item(row)->setData(seconds, ActivityModel::ActivitySecondsRole);
+}
+
+QStringList ActivitySortModelTest::shown() const
+{
+    // Activities moved over the boundary by others are filtered again from the event loop
+    QCoreApplication::processEvents();
+
+    QStringList result;
+    for (int row = 0; row < model->rowCount(); row++) {
+        result << model->index(row, 0).data(ActivityModel::ActivityNameRole).toString();
+    }
+    return result;
+}
+
+void ActivitySortModelTest::testMaximumCount()
+{
+    appendActivity(QStringLiteral("konsole"), 100);
+    appendActivity(QStringLiteral("firefox"), 300);
+    appendActivity(QStringLiteral("dolphin"), 200);
+    appendActivity(QStringLiteral("kate"), 50);
+    model->setMaximumCount(2);
+    model->setSourceModel(source);
+
+    QCOMPARE(shown(), QStringList() << QStringLiteral("firefox") << QStringLiteral("dolphin"));
+    QCOMPARE(model->restCount(), 2);
+
+    model->setMaximumCount(0);
+    QCOMPARE(shown().count(), 4);
+    QCOMPARE(model->restCount(), 0);
+}
+
+void ActivitySortModelTest::testMinimumSeconds()
+{
+    appendActivity(QStringLiteral("konsole"), 100);
+    appendActivity(QStringLiteral("firefox"), 3);
+    model->setSourceModel(source);
+    model->setMinimumSeconds(60);
+
+    QCOMPARE(shown(), QStringList() << QStringLiteral("konsole"));
+    QCOMPARE(model->restCount(), 1);
+
+    setSeconds(1, 120);
+    QCOMPARE(shown(), QStringList() << QStringLiteral("firefox") << QStringLiteral("konsole"));
+    QCOMPARE(model->restCount(), 0);
+}
+
+void ActivitySortModelTest::testBoundaryCrossed()
+{
+    appendActivity(QStringLiteral("konsole"), 100);
+    appendActivity(QStringLiteral("firefox"), 300);
+    appendActivity(QStringLiteral("dolphin"), 200);
+    model->setMaximumCount(2);
+    model->setSourceModel(source);
+    QCOMPARE(shown(), QStringList() << QStringLiteral("firefox") << QStringLiteral("dolphin"));
+
+    // Konsole pushes dolphin out, which didn't change itself
+    setSeconds(0, 400);
+    QCOMPARE(shown(), QStringList() << QStringLiteral("konsole") << QStringLiteral("firefox"));
+    QCOMPARE(model->restCount(), 1);
+    QCOMPARE(model->restTime(), QStringLiteral("00:03:20"));
+}
+
+void ActivitySortModelTest::testRowsInsertedAndRemoved()
+{
+    appendActivity(QStringLiteral("konsole"), 100);
+    appendActivity(QStringLiteral("firefox"), 300);
+    model->setMaximumCount(2);
+    model->setSourceModel(source);
+
+    appendActivity(QStringLiteral("dolphin"), 200);
+    QCOMPARE(shown(), QStringList() << QStringLiteral("firefox") << QStringLiteral("dolphin"));
+
+    // The best ranked out activity takes the freed place
+    source->removeRow(1);
+    QCOMPARE(shown(), QStringList() << QStringLiteral("dolphin") << QStringLiteral("konsole"));
+    QCOMPARE(model->restCount(), 0);
+}
+
+void ActivitySortModelTest::testRenamed()
+{
+    appendActivity(QStringLiteral("konsole"), 100);
+    appendActivity(QStringLiteral("firefox"), 300);
+    appendActivity(QStringLiteral("dolphin"), 200);
+    model->setMaximumCount(2);
+    model->setSourceModel(source);
+
+    // Ignored activities become the other applications, which are always shown
+    source->item(1)->setData(QStringLiteral("other applications"), ActivityModel::ActivityNameRole);
+    QCOMPARE(shown(), QStringList() << QStringLiteral("dolphin") << QStringLiteral("konsole") << QStringLiteral("other applications"));
+    QCOMPARE(model->restCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(ActivitySortModelTest)
+
+#include "activitysortmodeltest.moc"
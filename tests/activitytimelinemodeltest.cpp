@@ -0,0 +1,230 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activityhistory.h"
+#include "activitytimelinemodel.h"
+
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+/*                       ActivityTimelineModelTest                         *
+ * ----------------------------------------------------------------------- */
+
+class ActivityTimelineModelTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testSegments();
+    void testMergeBelowPixel();
+    void testLongInterval();
+    void testSharedLane();
+    void testRefreshWhileActive();
+    void testAppendedIntervals();
+
+private:
+    void append(const QString &activity, int offsetSeconds, int seconds);
+    bool showRange(int fromSeconds, int toSeconds, int pixelWidth);
+
+    QScopedPointer<QTemporaryDir> dir;
+    QScopedPointer<ActivityHistory> writer;
+    QScopedPointer<ActivityTimelineModel> model;
+    QDateTime day;
+};
+
+void ActivityTimelineModelTest::init()
+{
+    dir.reset(new QTemporaryDir());
+    QVERIFY(dir->isValid());
+
+    const QString path = dir->path() + QStringLiteral("/history");
+    day = QDateTime(QDate(2018, 3, 1), QTime(0, 0), Qt::UTC);
+    writer.reset(new ActivityHistory(path));
+
+    model.reset(new ActivityTimelineModel());
+    model->setHistoryPath(path);
+}
+
+void ActivityTimelineModelTest::cleanup()
+{
+    model.reset();
+    writer.reset();
+    dir.reset();
+}
+
+void ActivityTimelineModelTest::append(const QString &activity, int offsetSeconds, int seconds)
+{
+    QVERIFY(writer->append(activity, day.addSecs(offsetSeconds), seconds));
+}
+
+bool ActivityTimelineModelTest::showRange(int fromSeconds, int toSeconds, int pixelWidth)
+{
+    QSignalSpy spy(model.data(), &ActivityTimelineModel::segmentsChanged);
+    model->setFrom(day.addSecs(fromSeconds));
+    model->setTo(day.addSecs(toSeconds));
+    model->setPixelWidth(pixelWidth);
+
+    return spy.wait(1000);
+}
+
+void ActivityTimelineModelTest::testSegments()
+{
+    append(QStringLiteral("konsole"), 3600, 600);
+    append(QStringLiteral("firefox"), 4200, 600);
+    append(QStringLiteral("konsole"), 4800, 600);
+    // Outside of the range
+    append(QStringLiteral("dolphin"), 20000, 600);
+
+    QVERIFY(showRange(0, 7200, 720));
+
+    QCOMPARE(model->laneActivities(), QStringList() << QStringLiteral("konsole") << QStringLiteral("firefox"));
+    QCOMPARE(model->rowCount(QModelIndex()), 3);
+
+    const QVector<ActivityTimelineModel::Segment> &segments = model->segments();
+    QCOMPARE(segments.at(0).start, day.addSecs(3600).toMSecsSinceEpoch());
+    QCOMPARE(segments.at(0).end, day.addSecs(4200).toMSecsSinceEpoch());
+    QCOMPARE(segments.at(0).lane, 0);
+    QCOMPARE(segments.at(1).lane, 1);
+    QCOMPARE(segments.at(2).lane, 0);
+}
+
+void ActivityTimelineModelTest::testMergeBelowPixel()
+{
+    // A second each with a second in between, a pixel is a minute
+    for (int i = 0; i < 1000; i++) {
+        append(QStringLiteral("konsole"), 2 * i, 1);
+    }
+
+    QVERIFY(showRange(0, 24 * 3600, 24 * 60));
+
+    QCOMPARE(model->rowCount(QModelIndex()), 1);
+    QCOMPARE(model->segments().at(0).start, day.toMSecsSinceEpoch());
+    QCOMPARE(model->segments().at(0).end, day.addSecs(1999).toMSecsSinceEpoch());
+
+    // Zoomed in they are apart again
+    QVERIFY(showRange(0, 20, 2000));
+    QCOMPARE(model->rowCount(QModelIndex()), 10);
+}
+
+void ActivityTimelineModelTest::testLongInterval()
+{
+    // Starts long before the range, with many short intervals in between
+    append(QStringLiteral("konsole"), 0, 10 * 3600);
+    for (int i = 0; i < 100; i++) {
+        append(QStringLiteral("firefox"), 60 + i * 300, 60);
+    }
+
+    QVERIFY(showRange(9 * 3600, 11 * 3600, 120));
+
+    QCOMPARE(model->laneActivities(), QStringList() << QStringLiteral("konsole"));
+    QCOMPARE(model->rowCount(QModelIndex()), 1);
+    QCOMPARE(model->segments().at(0).start, day.addSecs(9 * 3600).toMSecsSinceEpoch());
+    QCOMPARE(model->segments().at(0).end, day.addSecs(10 * 3600).toMSecsSinceEpoch());
+}
+
+void ActivityTimelineModelTest::testSharedLane()
+{
+    // Activity i is used for i minutes
+    for (int i = 1; i <= 10; i++) {
+        append(QStringLiteral("app%1").arg(i), i * 3600, i * 60);
+    }
+
+    model->setMaximumLanes(4);
+    QVERIFY(showRange(0, 12 * 3600, 720));
+
+    QCOMPARE(model->laneCount(), 4);
+    QCOMPARE(model->laneActivity(0), QStringLiteral("app8"));
+    QCOMPARE(model->laneActivity(1), QStringLiteral("app9"));
+    QCOMPARE(model->laneActivity(2), QStringLiteral("app10"));
+    QCOMPARE(model->rowCount(QModelIndex()), 10);
+
+    int shared = 0;
+    foreach (const ActivityTimelineModel::Segment &segment, model->segments()) {
+        if (segment.lane == 3) {
+            shared++;
+        }
+    }
+    QCOMPARE(shared, 7);
+}
+
+void ActivityTimelineModelTest::testRefreshWhileActive()
+{
+    append(QStringLiteral("konsole"), 3600, 600);
+    QVERIFY(showRange(0, 7200, 720));
+    QCOMPARE(model->rowCount(QModelIndex()), 1);
+
+    // Nothing is read while hidden
+    model->setActive(false);
+    append(QStringLiteral("firefox"), 4200, 600);
+    QSignalSpy spy(model.data(), &ActivityTimelineModel::segmentsChanged);
+    QVERIFY(!spy.wait(100));
+    QCOMPARE(model->rowCount(QModelIndex()), 1);
+
+    // Shown again, the new interval turns up right away
+    model->setActive(true);
+    QVERIFY(spy.wait(1000));
+    QCOMPARE(model->rowCount(QModelIndex()), 2);
+    QCOMPARE(model->laneActivities(), QStringList() << QStringLiteral("konsole") << QStringLiteral("firefox"));
+}
+
+void ActivityTimelineModelTest::testAppendedIntervals()
+{
+    append(QStringLiteral("konsole"), 3600, 600);
+    append(QStringLiteral("firefox"), 4200, 600);
+    QVERIFY(showRange(0, 7200, 720));
+    QCOMPARE(model->rowCount(QModelIndex()), 2);
+    const QColor konsoleColor = model->laneColor(0);
+
+    QSignalSpy resetSpy(model.data(), &QAbstractItemModel::modelReset);
+    QSignalSpy insertedSpy(model.data(), &QAbstractItemModel::rowsInserted);
+    QSignalSpy changedSpy(model.data(), &QAbstractItemModel::dataChanged);
+    QSignalSpy segmentsSpy(model.data(), &ActivityTimelineModel::segmentsChanged);
+
+    // Less than a pixel after the last segment of its lane, which grows
+    append(QStringLiteral("firefox"), 4805, 100);
+    // Apart from the others, a row of its own
+    append(QStringLiteral("konsole"), 6000, 60);
+    QVERIFY(QMetaObject::invokeMethod(model.data(), "checkHistory"));
+    QVERIFY(segmentsSpy.wait(1000));
+
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(insertedSpy.count(), 1);
+    QCOMPARE(model->rowCount(QModelIndex()), 3);
+    QCOMPARE(model->segments().at(1).end, day.addSecs(4905).toMSecsSinceEpoch());
+    QCOMPARE(model->segments().at(2).start, day.addSecs(6000).toMSecsSinceEpoch());
+    QCOMPARE(model->segments().at(2).lane, 0);
+    QCOMPARE(model->laneColor(0), konsoleColor);
+
+    // A new activity needs a lane, which is only done by building everything anew
+    append(QStringLiteral("dolphin"), 6600, 60);
+    QVERIFY(QMetaObject::invokeMethod(model.data(), "checkHistory"));
+    QVERIFY(segmentsSpy.wait(1000));
+    QCOMPARE(resetSpy.count(), 1);
+    QCOMPARE(model->laneCount(), 3);
+    QCOMPARE(model->rowCount(QModelIndex()), 4);
+}
+
+QTEST_GUILESS_MAIN(ActivityTimelineModelTest)
+
+#include "activitytimelinemodeltest.moc"
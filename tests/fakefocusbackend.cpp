@@ -0,0 +1,100 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fakefocusbackend.h"
+
+/*                          FakeFocusBackend                               *
+ * ----------------------------------------------------------------------- */
+
+FakeFocusBackend::FakeFocusBackend(QObject *parent)
+    : FocusBackend(parent),
+      m_activeWindow(0)
+{
+}
+
+FakeFocusBackend::~FakeFocusBackend()
+{
+}
+
+WId FakeFocusBackend::activeWindow() const
+{
+    return m_activeWindow;
+}
+
+bool FakeFocusBackend::isResolved(WId window) const
+{
+    return m_resolvedWindows.contains(window);
+}
+
+QString FakeFocusBackend::windowClass(WId window) const
+{
+    return m_resolvedWindows.contains(window) ? m_windowClasses.value(window) : QString();
+}
+
+QPixmap FakeFocusBackend::windowIcon(WId window)
+{
+    return m_resolvedWindows.contains(window) ? m_windowIcons.value(window) : QPixmap();
+}
+
+void FakeFocusBackend::resolve(WId window)
+{
+    Q_UNUSED(window);
+}
+
+void FakeFocusBackend::addWindow(WId window, const QString &windowClass, bool resolved)
+{
+    m_windowClasses.insert(window, windowClass);
+    if (resolved) {
+        m_resolvedWindows.insert(window);
+    }
+}
+
+void FakeFocusBackend::removeWindow(WId window)
+{
+    const bool resolved = m_resolvedWindows.remove(window);
+    m_windowClasses.remove(window);
+    m_windowIcons.remove(window);
+
+    if (!resolved) {
+        Q_EMIT windowResolved(window);
+    }
+}
+
+void FakeFocusBackend::setWindowIcon(WId window, const QPixmap &icon)
+{
+    m_windowIcons.insert(window, icon);
+}
+
+void FakeFocusBackend::resolveWindow(WId window)
+{
+    m_resolvedWindows.insert(window);
+    Q_EMIT windowResolved(window);
+}
+
+void FakeFocusBackend::setActiveWindow(WId window)
+{
+    m_activeWindow = window;
+    Q_EMIT activeWindowChanged(window);
+}
+
+int FakeFocusBackend::windowCount() const
+{
+    return m_windowClasses.count();
+}
@@ -0,0 +1,63 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLASMA_TIMEKEEPER_FAKE_FOCUS_BACKEND_H
+#define PLASMA_TIMEKEEPER_FAKE_FOCUS_BACKEND_H
+
+#include "focusbackend.h"
+
+#include <QHash>
+#include <QSet>
+
+/*                          FakeFocusBackend                               *
+ * ----------------------------------------------------------------------- */
+
+// Focus backend driven by the tests, windows are whatever the test adds
+class FakeFocusBackend : public FocusBackend
+{
+Q_OBJECT
+public:
+    explicit FakeFocusBackend(QObject *parent = 0);
+    virtual ~FakeFocusBackend();
+
+    WId activeWindow() const Q_DECL_OVERRIDE;
+    bool isResolved(WId window) const Q_DECL_OVERRIDE;
+    QString windowClass(WId window) const Q_DECL_OVERRIDE;
+    QPixmap windowIcon(WId window) Q_DECL_OVERRIDE;
+    void resolve(WId window) Q_DECL_OVERRIDE;
+
+    // Unresolved windows stay so until resolveWindow() is called. Like the real
+    // backends, removing an unresolved window announces it as resolved without a class.
+    void addWindow(WId window, const QString &windowClass, bool resolved = true);
+    void removeWindow(WId window);
+    void setWindowIcon(WId window, const QPixmap &icon);
+    void resolveWindow(WId window);
+    void setActiveWindow(WId window);
+
+    int windowCount() const;
+
+private:
+    WId m_activeWindow;
+    QHash<WId, QString> m_windowClasses;
+    QSet<WId> m_resolvedWindows;
+    QHash<WId, QPixmap> m_windowIcons;
+};
+
+#endif // PLASMA_TIMEKEEPER_FAKE_FOCUS_BACKEND_H
@@ -0,0 +1,357 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "activitymodel.h"
+#include "fakefocusbackend.h"
+
+#include <KConfigGroup>
+#include <KSharedConfig>
+
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusUnixFileDescriptor>
+#include <QFile>
+#include <QGuiApplication>
+#include <QProcess>
+#include <QSignalSpy>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <cstdio>
+#include <unistd.h>
+
+/*                             FakeLogind                                  *
+ * ----------------------------------------------------------------------- */
+
+// Stand-in for the logind manager, run in a child process on the private bus.
+// It is driven through stdin ("sleep", "wake", "shutdown") and reports on stdout
+// whenever an inhibitor is taken ("inhibited") or released ("released").
+class FakeLogind : public QObject
+{
+Q_OBJECT
+Q_CLASSINFO("D-Bus Interface", "org.freedesktop.login1.Manager")
+public:
+    explicit FakeLogind(QObject *parent = 0);
+
+public Q_SLOTS:
+    Q_SCRIPTABLE QDBusUnixFileDescriptor Inhibit(const QString &what, const QString &who, const QString &why, const QString &mode);
+
+Q_SIGNALS:
+    Q_SCRIPTABLE void PrepareForSleep(bool start);
+    Q_SCRIPTABLE void PrepareForShutdown(bool start);
+
+private Q_SLOTS:
+    void readCommand();
+
+private:
+    static void report(const char *line);
+
+    QSocketNotifier m_stdinNotifier;
+};
+
+FakeLogind::FakeLogind(QObject *parent)
+    : QObject(parent),
+      m_stdinNotifier(STDIN_FILENO, QSocketNotifier::Read)
+{
+    connect(&m_stdinNotifier, &QSocketNotifier::activated, this, &FakeLogind::readCommand);
+}
+
+void FakeLogind::report(const char *line)
+{
+    printf("%s\n", line);
+    fflush(stdout);
+}
+
+QDBusUnixFileDescriptor FakeLogind::Inhibit(const QString &what, const QString &who, const QString &why, const QString &mode)
+{
+    Q_UNUSED(who);
+    Q_UNUSED(why);
+
+    if (what != QLatin1String("shutdown:sleep") || mode != QLatin1String("delay")) {
+        report("unexpected");
+    }
+
+    // The inhibitor is held as long as someone keeps the write end open
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return QDBusUnixFileDescriptor();
+    }
+
+    QSocketNotifier *notifier = new QSocketNotifier(fds[0], QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, [notifier] (int fd) {
+        char buffer;
+        if (read(fd, &buffer, 1) <= 0) {
+            notifier->setEnabled(false);
+            notifier->deleteLater();
+            close(fd);
+            report("released");
+        }
+    });
+
+    const QDBusUnixFileDescriptor descriptor(fds[1]);
+    close(fds[1]);
+
+    report("inhibited");
+    return descriptor;
+}
+
+void FakeLogind::readCommand()
+{
+    char line[64];
+    if (!fgets(line, sizeof(line), stdin)) {
+        QCoreApplication::quit();
+        return;
+    }
+
+    const QByteArray command = QByteArray(line).trimmed();
+    if (command == "sleep") {
+        Q_EMIT PrepareForSleep(true);
+    } else if (command == "wake") {
+        Q_EMIT PrepareForSleep(false);
+    } else if (command == "shutdown") {
+        Q_EMIT PrepareForShutdown(true);
+    }
+}
+
+static int fakeLogind(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    FakeLogind logind;
+    QDBusConnection bus = QDBusConnection::systemBus();
+    if (!bus.registerObject(QStringLiteral("/org/freedesktop/login1"), &logind, QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals) ||
+        !bus.registerService(QStringLiteral("org.freedesktop.login1"))) {
+        return 1;
+    }
+
+    printf("ready\n");
+    fflush(stdout);
+
+    return app.exec();
+}
+
+/*                         SleepInhibitorTest                              *
+ * ----------------------------------------------------------------------- */
+
+class SleepInhibitorTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void cleanupTestCase();
+    void testFlushBeforeSleep();
+    void testResetOnSuspend();
+    void testResetOnShutdown();
+    void testPendingReset();
+
+private:
+    bool waitForLine(const QByteArray &expected);
+    KSharedConfigPtr config() const;
+
+    QTemporaryDir m_runtimeDir;
+    QProcess m_bus;
+    QProcess m_logind;
+};
+
+bool SleepInhibitorTest::waitForLine(const QByteArray &expected)
+{
+    // The model needs the event loop to get the reply of its calls
+    for (int i = 0; i < 100 && !m_logind.canReadLine(); i++) {
+        QTest::qWait(50);
+        m_logind.waitForReadyRead(50);
+    }
+
+    if (!m_logind.canReadLine()) {
+        return false;
+    }
+
+    const QByteArray line = m_logind.readLine().trimmed();
+    if (line != expected) {
+        qWarning() << "Expected" << expected << "from logind, got" << line;
+        return false;
+    }
+
+    return true;
+}
+
+KSharedConfigPtr SleepInhibitorTest::config() const
+{
+    KSharedConfigPtr config = KSharedConfig::openConfig(QStringLiteral("plasma-timekeeper"), KConfig::SimpleConfig);
+    config->reparseConfiguration();
+    return config;
+}
+
+void SleepInhibitorTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    QVERIFY(m_runtimeDir.isValid());
+    qputenv("XDG_RUNTIME_DIR", QFile::encodeName(m_runtimeDir.path()));
+
+    // Private bus standing in for both the system and the session bus
+    m_bus.start(QStringLiteral("dbus-daemon"), QStringList() << QStringLiteral("--session") << QStringLiteral("--nofork") << QStringLiteral("--print-address"));
+    if (!m_bus.waitForStarted()) {
+        QSKIP("dbus-daemon is not available");
+    }
+    QVERIFY(m_bus.waitForReadyRead(5000));
+    const QByteArray address = m_bus.readLine().trimmed();
+    QVERIFY(!address.isEmpty());
+
+    qputenv("DBUS_SYSTEM_BUS_ADDRESS", address);
+    qputenv("DBUS_SESSION_BUS_ADDRESS", address);
+    QVERIFY(QDBusConnection::systemBus().isConnected());
+}
+
+void SleepInhibitorTest::init()
+{
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/plasma-timekeeper"));
+    config();
+
+    m_logind.start(QCoreApplication::applicationFilePath(), QStringList() << QStringLiteral("--fake-logind"));
+    QVERIFY(m_logind.waitForStarted());
+    QVERIFY(m_logind.waitForReadyRead(5000));
+    QCOMPARE(m_logind.readLine().trimmed(), QByteArray("ready"));
+
+    // Wait until the name is visible for us as well
+    QTRY_VERIFY(QDBusConnection::systemBus().interface()->isServiceRegistered(QStringLiteral("org.freedesktop.login1")));
+}
+
+void SleepInhibitorTest::cleanup()
+{
+    m_logind.closeWriteChannel();
+    if (!m_logind.waitForFinished(2000)) {
+        m_logind.kill();
+        m_logind.waitForFinished();
+    }
+}
+
+void SleepInhibitorTest::cleanupTestCase()
+{
+    if (m_bus.state() == QProcess::Running) {
+        m_bus.terminate();
+        m_bus.waitForFinished();
+    }
+}
+
+void SleepInhibitorTest::testFlushBeforeSleep()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    backend->addWindow(1, QStringLiteral("konsole"));
+    backend->setActiveWindow(1);
+
+    ActivityModel model(backend);
+    model.setResetOnSuspend(false);
+    QVERIFY(waitForLine("inhibited"));
+    QCOMPARE(model.rowCount(QModelIndex()), 1);
+    QCOMPARE(model.lastFlushLatency(), -1);
+
+    QTest::qWait(1100);
+
+    // The inhibitor has to be released once the time is written
+    m_logind.write("sleep\n");
+    QVERIFY(waitForLine("released"));
+    QVERIFY(model.lastFlushLatency() >= 0);
+
+    KConfigGroup group(config(), QStringLiteral("konsole"));
+    QVERIFY(QTime::fromString(group.readEntry(QStringLiteral("time"))) >= QTime(0, 0, 1));
+    QCOMPARE(model.rowCount(QModelIndex()), 1);
+
+    // Nothing is tracked while sleeping, waking up takes the inhibitor again
+    QCOMPARE(model.currentActivityTime(), QString());
+    m_logind.write("wake\n");
+    QVERIFY(waitForLine("inhibited"));
+    QCOMPARE(model.currentActivityName(), QStringLiteral("konsole"));
+}
+
+void SleepInhibitorTest::testResetOnSuspend()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    backend->addWindow(1, QStringLiteral("konsole"));
+    backend->setActiveWindow(1);
+
+    ActivityModel model(backend);
+    model.setResetOnSuspend(true);
+    QVERIFY(waitForLine("inhibited"));
+    QCOMPARE(model.rowCount(QModelIndex()), 1);
+
+    m_logind.write("sleep\n");
+    QVERIFY(waitForLine("released"));
+
+    QCOMPARE(model.rowCount(QModelIndex()), 0);
+    QCOMPARE(model.totalActivityTime(), QStringLiteral("00:00:00"));
+
+    KSharedConfigPtr reparsed = config();
+    QVERIFY(!reparsed->hasGroup(QStringLiteral("konsole")));
+    QVERIFY(!KConfigGroup(reparsed, QStringLiteral("general")).hasKey(QStringLiteral("resetPending")));
+
+    m_logind.write("wake\n");
+    QVERIFY(waitForLine("inhibited"));
+}
+
+void SleepInhibitorTest::testResetOnShutdown()
+{
+    FakeFocusBackend *backend = new FakeFocusBackend();
+    backend->addWindow(1, QStringLiteral("konsole"));
+    backend->setActiveWindow(1);
+
+    ActivityModel model(backend);
+    model.setResetOnShutdown(true);
+    QVERIFY(waitForLine("inhibited"));
+
+    m_logind.write("shutdown\n");
+    QVERIFY(waitForLine("released"));
+    QCOMPARE(model.rowCount(QModelIndex()), 0);
+}
+
+void SleepInhibitorTest::testPendingReset()
+{
+    // Shut down before the reset got done
+    KSharedConfigPtr config = this->config();
+    KConfigGroup group(config, QStringLiteral("konsole"));
+    group.writeEntry(QStringLiteral("name"), QStringLiteral("konsole"));
+    group.writeEntry(QStringLiteral("time"), QTime(1, 0).toString(Qt::RFC2822Date));
+    KConfigGroup(config, QStringLiteral("general")).writeEntry(QStringLiteral("resetPending"), true);
+    config->sync();
+
+    ActivityModel model(new FakeFocusBackend());
+    QVERIFY(waitForLine("inhibited"));
+    QCOMPARE(model.rowCount(QModelIndex()), 0);
+    QCOMPARE(model.totalActivityTime(), QStringLiteral("00:00:00"));
+    QVERIFY(!this->config()->hasGroup(QStringLiteral("konsole")));
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && qstrcmp(argv[1], "--fake-logind") == 0) {
+        return fakeLogind(argc, argv);
+    }
+
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    SleepInhibitorTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "sleepinhibitortest.moc"
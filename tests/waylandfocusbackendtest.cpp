@@ -0,0 +1,227 @@
+/*
+    Copyright 2016-2018 Jan Grulich <jgrulich@redhat.com>
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) version 3, or any
+    later version accepted by the membership of KDE e.V. (or its
+    successor approved by the membership of KDE e.V.), which shall
+    act as a proxy defined in Section 6 of version 3 of the license.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "waylandfocusbackend.h"
+
+#include <KWayland/Client/connection_thread.h>
+#include <KWayland/Server/display.h>
+#include <KWayland/Server/plasmawindowmanagement_interface.h>
+
+#include <QGuiApplication>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+#include <QVector>
+
+using namespace KWayland;
+
+/*                       WaylandFocusBackendTest                           *
+ * ----------------------------------------------------------------------- */
+
+// The backend talks to an in-process compositor implementing only the Plasma
+// window management protocol, the same one Plasma Wayland sessions have
+class WaylandFocusBackendTest : public QObject
+{
+Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testActivatedWithAppId();
+    void testAppIdLater();
+    void testUnmappedWhilePending();
+    void testIconDeferred();
+
+private:
+    Server::PlasmaWindowInterface *createWindow(const QString &appId);
+
+    Server::Display *m_display;
+    Server::PlasmaWindowManagementInterface *m_management;
+    Client::ConnectionThread *m_connection;
+    QThread *m_thread;
+    WaylandFocusBackend *m_backend;
+};
+
+void WaylandFocusBackendTest::init()
+{
+    const QString socketName = QStringLiteral("timekeeper-test-%1").arg(QCoreApplication::applicationPid());
+
+    m_display = new Server::Display(this);
+    m_display->setSocketName(socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+
+    m_management = m_display->createPlasmaWindowManagement(m_display);
+    m_management->create();
+
+    m_connection = new Client::ConnectionThread();
+    m_connection->setSocketName(socketName);
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    QSignalSpy connectedSpy(m_connection, &Client::ConnectionThread::connected);
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_backend = new WaylandFocusBackend(m_connection, this);
+
+    // Nothing is active yet, so wait until the window management is bound by
+    // creating a window and seeing it activated
+    Server::PlasmaWindowInterface *window = createWindow(QStringLiteral("plasmashell"));
+    QSignalSpy activeSpy(m_backend, &FocusBackend::activeWindowChanged);
+    window->setActive(true);
+    QVERIFY(activeSpy.wait());
+    window->setActive(false);
+    QTRY_COMPARE(m_backend->activeWindow(), WId(0));
+}
+
+void WaylandFocusBackendTest::cleanup()
+{
+    delete m_backend;
+    m_backend = 0;
+
+    m_connection->deleteLater();
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+
+    delete m_display;
+}
+
+Server::PlasmaWindowInterface *WaylandFocusBackendTest::createWindow(const QString &appId)
+{
+    Server::PlasmaWindowInterface *window = m_management->createWindow(m_management);
+    if (!appId.isEmpty()) {
+        window->setAppId(appId);
+    }
+    return window;
+}
+
+void WaylandFocusBackendTest::testActivatedWithAppId()
+{
+    // The activation may reach the client before the window is announced to it,
+    // either way the window must be resolved when it gets active or announced
+    // once it is, like the model asks for it
+    QVector<WId> resolvedWhenActivated;
+    connect(m_backend, &FocusBackend::activeWindowChanged, this, [this, &resolvedWhenActivated] (WId window) {
+        if (!window) {
+            return;
+        }
+        if (m_backend->isResolved(window)) {
+            resolvedWhenActivated << window;
+        } else {
+            m_backend->resolve(window);
+        }
+    });
+    QSignalSpy activeSpy(m_backend, &FocusBackend::activeWindowChanged);
+    QSignalSpy resolvedSpy(m_backend, &FocusBackend::windowResolved);
+
+    Server::PlasmaWindowInterface *window = createWindow(QStringLiteral("konsole"));
+    window->setActive(true);
+    QVERIFY(activeSpy.wait());
+
+    const WId id = m_backend->activeWindow();
+    QVERIFY(id);
+
+    if (!resolvedWhenActivated.contains(id)) {
+        QTRY_VERIFY(!resolvedSpy.isEmpty());
+        QCOMPARE(resolvedSpy.last().at(0).value<WId>(), id);
+    }
+
+    QVERIFY(m_backend->isResolved(id));
+    QCOMPARE(m_backend->windowClass(id), QStringLiteral("konsole"));
+}
+
+void WaylandFocusBackendTest::testAppIdLater()
+{
+    QSignalSpy activeSpy(m_backend, &FocusBackend::activeWindowChanged);
+    QSignalSpy resolvedSpy(m_backend, &FocusBackend::windowResolved);
+
+    Server::PlasmaWindowInterface *window = createWindow(QString());
+    window->setActive(true);
+    QVERIFY(activeSpy.wait());
+
+    const WId id = m_backend->activeWindow();
+    QVERIFY(id);
+    QVERIFY(!m_backend->isResolved(id));
+    m_backend->resolve(id);
+
+    window->setAppId(QStringLiteral("org.kde.dolphin"));
+    QVERIFY(resolvedSpy.wait());
+    QCOMPARE(resolvedSpy.last().at(0).value<WId>(), id);
+    QCOMPARE(m_backend->windowClass(id), QStringLiteral("org.kde.dolphin"));
+}
+
+void WaylandFocusBackendTest::testUnmappedWhilePending()
+{
+    QSignalSpy activeSpy(m_backend, &FocusBackend::activeWindowChanged);
+    QSignalSpy resolvedSpy(m_backend, &FocusBackend::windowResolved);
+
+    Server::PlasmaWindowInterface *window = createWindow(QString());
+    window->setActive(true);
+    QVERIFY(activeSpy.wait());
+
+    const WId id = m_backend->activeWindow();
+    m_backend->resolve(id);
+
+    // Announced without a class, so whoever waits for it can give up
+    window->unmap();
+    QVERIFY(resolvedSpy.wait());
+    QCOMPARE(resolvedSpy.last().at(0).value<WId>(), id);
+    QVERIFY(m_backend->windowClass(id).isEmpty());
+}
+
+void WaylandFocusBackendTest::testIconDeferred()
+{
+    QSignalSpy activeSpy(m_backend, &FocusBackend::activeWindowChanged);
+    QSignalSpy iconSpy(m_backend, &FocusBackend::iconResolved);
+
+    Server::PlasmaWindowInterface *window = createWindow(QStringLiteral("konsole"));
+    window->setThemedIconName(QStringLiteral("utilities-terminal"));
+    window->setActive(true);
+    QVERIFY(activeSpy.wait());
+
+    const WId id = m_backend->activeWindow();
+
+    // Nothing is rendered until the event loop runs again
+    m_backend->windowIcon(id);
+    m_backend->windowIcon(id);
+    QVERIFY(iconSpy.isEmpty());
+
+    QVERIFY(iconSpy.wait());
+    QCOMPARE(iconSpy.count(), 1);
+    QCOMPARE(iconSpy.first().at(0).value<WId>(), id);
+
+    // From the cache from now on
+    m_backend->windowIcon(id);
+    QTest::qWait(50);
+    QCOMPARE(iconSpy.count(), 1);
+}
+
+int main(int argc, char **argv)
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    WaylandFocusBackendTest test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "waylandfocusbackendtest.moc"